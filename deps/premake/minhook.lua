@@ -9,7 +9,8 @@ end
 
 function minhook.includes()
 	includedirs {
-		path.join(minhook.source, "include")
+		path.join(minhook.source, "include"),
+		path.join(minhook.source, "src"),
 	}
 end
 
@@ -77,6 +77,11 @@ newoption {
 	description = "Enable development builds of the client."
 }
 
+newoption {
+	trigger = "lock-instrumentation",
+	description = "Record contention statistics for all utils::concurrency locks."
+}
+
 newaction {
 	trigger = "version",
 	description = "Returns the version string for the current commit of the source code.",
@@ -244,6 +249,10 @@ workspace "boiii"
 		defines {"DEV_BUILD"}
 	end
 
+	if _OPTIONS["lock-instrumentation"] then
+		defines {"LOCK_INSTRUMENTATION"}
+	end
+
 	if os.getenv("CI") then
 		defines {"CI"}
 	end
@@ -306,5 +315,39 @@ project "client"
 
 	dependencies.imports()
 
+project "benchmark"
+	kind "ConsoleApp"
+	language "C++"
+
+	files {
+		"./src/benchmark/**.hpp", "./src/benchmark/**.cpp",
+		"./src/client/component/scheduler.hpp", "./src/client/component/scheduler.cpp",
+		"./src/common/utils/concurrency.hpp", "./src/common/utils/concurrency.cpp",
+	}
+
+	-- The headers in src/benchmark stand in for the client's Windows-only ones
+	includedirs {"./src/benchmark", "./src/common"}
+
+	filter "system:not windows"
+		removedefines {"_WINDOWS", "WIN32"}
+		removebuildoptions {"/GL"}
+		removelinkoptions {"/IGNORE:4702", "/LTCG"}
+		disablewarnings {"unused-function"}
+		links {"pthread"}
+	filter {}
+
+-- Throughput of the utils in common, needs the same Windows toolchain as the client
+project "utils-benchmark"
+	kind "ConsoleApp"
+	language "C++"
+
+	files {"./src/utils-benchmark/**.hpp", "./src/utils-benchmark/**.cpp"}
+
+	includedirs {"./src/utils-benchmark", "./src/common", "%{prj.location}/src"}
+
+	links {"common"}
+
+	dependencies.imports()
+
 group "Dependencies"
 	dependencies.projects()
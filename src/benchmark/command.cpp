@@ -0,0 +1,7 @@
+#include "../client/component/command.hpp"
+
+// Stand-in for the console, the scheduler registers its commands in post_unpack, which never runs here.
+// Defined against the client's declaration, so a signature change fails to compile instead of being dropped.
+void command::add(const char* /*name*/, void (* /*function*/)())
+{
+}
@@ -0,0 +1,183 @@
+#include <std_include.hpp>
+#include "containers.hpp"
+
+#include <utils/concurrency.hpp>
+
+#include <cstdio>
+#include <random>
+
+namespace benchmark
+{
+	namespace
+	{
+		using registry = std::map<uint32_t, uint32_t>;
+
+		constexpr uint32_t registry_size = 1'024;
+		constexpr auto measure_time = 250ms;
+
+		// One writer updates an entry at a fixed interval, like a registry that changes now and then
+		constexpr auto write_interval = 1ms;
+
+		registry create_registry()
+		{
+			registry object{};
+			for (uint32_t i = 0; i < registry_size; ++i)
+			{
+				object[i] = i;
+			}
+
+			return object;
+		}
+
+		struct container_result
+		{
+			uint64_t reads{};
+			uint64_t writes{};
+			std::chrono::duration<double> time{};
+		};
+
+		template <typename Read, typename Write>
+		container_result run_contention(const size_t reader_count, Read&& read, Write&& write)
+		{
+			std::atomic_bool started{false};
+			std::atomic_bool running{true};
+			std::atomic<uint64_t> reads{0};
+			uint64_t writes = 0;
+
+			// Keeps the lookups from being optimized away
+			std::atomic<uint64_t> checksum_sink{0};
+
+			std::vector<std::thread> readers{};
+			for (size_t i = 0; i < reader_count; ++i)
+			{
+				readers.emplace_back([&, i]
+				{
+					std::mt19937 rng{static_cast<uint32_t>(i)};
+					std::uniform_int_distribution<uint32_t> key_distribution{0, registry_size - 1};
+
+					uint64_t count = 0;
+					uint64_t checksum = 0;
+
+					while (!started.load(std::memory_order_acquire))
+					{
+						std::this_thread::yield();
+					}
+
+					while (running.load(std::memory_order_relaxed))
+					{
+						checksum += read(key_distribution(rng));
+						++count;
+					}
+
+					reads += count;
+					checksum_sink += checksum;
+				});
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			started = true;
+
+			// A starved writer can overshoot the measuring time, the rates use the actual time
+			const auto end = start + measure_time;
+			while (std::chrono::steady_clock::now() < end)
+			{
+				write(static_cast<uint32_t>(writes % registry_size));
+				++writes;
+
+				std::this_thread::sleep_for(write_interval);
+			}
+
+			running = false;
+			const auto time = std::chrono::steady_clock::now() - start;
+
+			for (auto& reader : readers)
+			{
+				reader.join();
+			}
+
+			return {reads.load(), writes, time};
+		}
+
+		void print_result(const char* name, const size_t reader_count, const container_result& result)
+		{
+			const auto seconds = result.time.count();
+
+			printf("%-20s %8zu %14.2f %10.0f\n", name, reader_count,
+			       static_cast<double>(result.reads) / seconds / 1'000'000.0,
+			       static_cast<double>(result.writes) / seconds);
+		}
+
+		void run_container(const size_t reader_count)
+		{
+			utils::concurrency::container<registry> object{};
+			object.get_raw() = create_registry();
+
+			print_result("container", reader_count, run_contention(reader_count, [&](const uint32_t key)
+			{
+				return object.access<uint32_t>([key](const registry& values)
+				{
+					return values.at(key);
+				});
+			}, [&](const uint32_t key)
+			{
+				object.access([key](registry& values)
+				{
+					++values[key];
+				});
+			}));
+		}
+
+		void run_shared_container(const size_t reader_count)
+		{
+			utils::concurrency::shared_container<registry> object{};
+			object.get_raw() = create_registry();
+
+			print_result("shared_container", reader_count, run_contention(reader_count, [&](const uint32_t key)
+			{
+				return object.access_shared<uint32_t>([key](const registry& values)
+				{
+					return values.at(key);
+				});
+			}, [&](const uint32_t key)
+			{
+				object.access([key](registry& values)
+				{
+					++values[key];
+				});
+			}));
+		}
+
+		void run_snapshot_container(const size_t reader_count)
+		{
+			utils::concurrency::snapshot_container<registry> object{create_registry()};
+
+			print_result("snapshot_container", reader_count, run_contention(reader_count, [&](const uint32_t key)
+			{
+				return object.access<uint32_t>([key](const registry& values)
+				{
+					return values.at(key);
+				});
+			}, [&](const uint32_t key)
+			{
+				object.update([key](registry& values)
+				{
+					++values[key];
+				});
+			}));
+		}
+	}
+
+	void run_container_benchmarks()
+	{
+		printf("Readers look up a %u entry map, one writer updates it every %lld ms, %u hardware threads\n\n",
+		       registry_size, static_cast<long long>(write_interval.count()), std::thread::hardware_concurrency());
+		printf("%-20s %8s %14s %10s\n", "container", "readers", "Mreads/s", "writes/s");
+
+		for (const size_t reader_count : {1u, 2u, 4u, 8u})
+		{
+			run_container(reader_count);
+			run_shared_container(reader_count);
+			run_snapshot_container(reader_count);
+		}
+	}
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace benchmark
+{
+	// Read throughput of the concurrency containers under a read-mostly load
+	void run_container_benchmarks();
+}
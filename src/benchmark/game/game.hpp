@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+namespace game
+{
+	inline void Com_Printf(int /*channel*/, unsigned int /*label*/, const char* fmt, ...)
+	{
+		va_list ap;
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "../../client/loader/component_interface.hpp"
+
+// Components are only instantiated, the benchmark drives the scheduler directly
+#define REGISTER_COMPONENT(name) \
+namespace                        \
+{                                \
+	name __component{};          \
+}
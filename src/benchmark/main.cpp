@@ -0,0 +1,401 @@
+#include <std_include.hpp>
+#include "../client/component/scheduler.hpp"
+#include "containers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+// Counts every allocation, so the API benchmark can report allocations per scheduled task
+std::atomic<uint64_t> allocation_count{0};
+
+void* operator new(const size_t size)
+{
+	++allocation_count;
+
+	if (auto* memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace
+{
+	using scheduler::clock;
+
+	// Frames run on the main pipeline, time only moves through the virtual clock.
+	// Task costs are simulated by advancing the clock, so overload is reproducible.
+	struct scenario
+	{
+		uint32_t frame_rate{};
+		size_t recurring_tasks{};
+		size_t tasks_per_frame{};
+		std::chrono::microseconds task_cost{};
+	};
+
+	struct scenario_state
+	{
+		bool recording{true};
+		std::vector<uint64_t> run_counts{};
+		std::vector<uint64_t> latencies{};
+		uint64_t tasks_run{};
+	};
+
+	constexpr auto simulated_time = 2s;
+	constexpr auto max_delay = 20ms;
+
+	scheduler::virtual_clock virtual_clock{};
+
+	uint64_t get_percentile(std::vector<uint64_t> values, const double percentile)
+	{
+		if (values.empty())
+		{
+			return 0;
+		}
+
+		std::ranges::sort(values);
+		const auto index = static_cast<size_t>(percentile * static_cast<double>(values.size() - 1));
+		return values[index];
+	}
+
+	double get_mean(const std::vector<uint64_t>& values)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+
+		double sum = 0.0;
+		for (const auto value : values)
+		{
+			sum += static_cast<double>(value);
+		}
+
+		return sum / static_cast<double>(values.size());
+	}
+
+	// Jain's index, 1.0 means every recurring task ran equally often
+	double get_fairness(const std::vector<uint64_t>& counts)
+	{
+		double sum = 0.0;
+		double square_sum = 0.0;
+		for (const auto count : counts)
+		{
+			sum += static_cast<double>(count);
+			square_sum += static_cast<double>(count) * static_cast<double>(count);
+		}
+
+		if (square_sum == 0.0)
+		{
+			return 1.0;
+		}
+
+		return (sum * sum) / (static_cast<double>(counts.size()) * square_sum);
+	}
+
+	void simulate_cost(const std::chrono::microseconds cost)
+	{
+		virtual_clock.advance(std::chrono::duration_cast<clock::duration>(cost));
+	}
+
+	void run_scenario(const scenario& scenario)
+	{
+		const auto frame_time = std::chrono::duration_cast<clock::duration>(1s) / scenario.frame_rate;
+		const auto frame_count = static_cast<size_t>(simulated_time / 1s) * scenario.frame_rate;
+
+		// Half of the frame is left for the game itself
+		scheduler::set_frame_budget(scheduler::pipeline::main,
+		                            std::chrono::duration_cast<std::chrono::microseconds>(frame_time / 2));
+
+		const auto stats_before = scheduler::get_frame_stats(scheduler::pipeline::main);
+
+		scenario_state state{};
+		state.run_counts.resize(scenario.recurring_tasks);
+
+		std::vector<scheduler::task_handle> recurring{};
+		for (size_t i = 0; i < scenario.recurring_tasks; ++i)
+		{
+			recurring.emplace_back(scheduler::loop([&state, &scenario, i]
+			{
+				simulate_cost(scenario.task_cost);
+				++state.run_counts[i];
+				++state.tasks_run;
+			}, scheduler::pipeline::main));
+		}
+
+		std::mt19937 rng{scenario.frame_rate};
+		std::uniform_int_distribution<int64_t> delay_distribution{0, max_delay.count()};
+
+		std::vector<uint64_t> frame_overheads{};
+		frame_overheads.reserve(frame_count);
+
+		for (size_t frame = 0; frame < frame_count; ++frame)
+		{
+			for (size_t i = 0; i < scenario.tasks_per_frame; ++i)
+			{
+				const std::chrono::milliseconds delay{delay_distribution(rng)};
+				const auto due = virtual_clock.now() + delay;
+
+				scheduler::schedule_detached([&state, &scenario, due]
+				{
+					if (state.recording)
+					{
+						simulate_cost(scenario.task_cost);
+						state.latencies.emplace_back((virtual_clock.now() - due).count());
+						++state.tasks_run;
+					}
+
+					return scheduler::cond_end;
+				}, scheduler::pipeline::main, delay);
+			}
+
+			const auto frame_start = virtual_clock.now();
+
+			const auto start = std::chrono::steady_clock::now();
+			scheduler::run_frame(scheduler::pipeline::main);
+			const auto end = std::chrono::steady_clock::now();
+
+			frame_overheads.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+			// An overloaded frame takes longer, otherwise the game waits for the next one
+			const auto elapsed = virtual_clock.now() - frame_start;
+			if (elapsed < frame_time)
+			{
+				virtual_clock.advance(frame_time - elapsed);
+			}
+		}
+
+		state.recording = false;
+		const auto stats_after = scheduler::get_frame_stats(scheduler::pipeline::main);
+
+		// Drain everything that is still pending, so the next scenario starts empty
+		for (const auto& task : recurring)
+		{
+			task.cancel();
+		}
+
+		scheduler::set_frame_budget(scheduler::pipeline::main, 0us);
+		virtual_clock.advance(std::chrono::duration_cast<clock::duration>(max_delay + frame_time));
+		scheduler::run_frame(scheduler::pipeline::main);
+
+		const auto total_overhead = get_mean(frame_overheads) * static_cast<double>(frame_overheads.size());
+
+		printf("%6u %6zu %6lld %10.2f %10.2f %8.1f %10.3f %10.3f %10llu %10llu %9.4f\n",
+		       scenario.frame_rate,
+		       scenario.recurring_tasks + scenario.tasks_per_frame,
+		       static_cast<long long>(scenario.task_cost.count()),
+		       get_mean(frame_overheads) / 1'000.0,
+		       static_cast<double>(get_percentile(frame_overheads, 0.99)) / 1'000.0,
+		       state.tasks_run ? total_overhead / static_cast<double>(state.tasks_run) : 0.0,
+		       get_mean(state.latencies) / 1'000'000.0,
+		       static_cast<double>(get_percentile(state.latencies, 0.99)) / 1'000'000.0,
+		       static_cast<unsigned long long>(stats_after.deferrals - stats_before.deferrals),
+		       static_cast<unsigned long long>(stats_after.overruns - stats_before.overruns),
+		       get_fairness(state.run_counts));
+	}
+
+	// Many recurring tasks with long intervals, like the game's periodic checks.
+	// A frame should only pay for the tasks that are due, not for everything that is scheduled.
+	void run_large_scenario(const size_t task_count)
+	{
+		constexpr auto frame_rate = 60u;
+		constexpr auto large_simulated_time = 10s;
+
+		const auto frame_time = std::chrono::duration_cast<clock::duration>(1s) / frame_rate;
+		const auto frame_count = static_cast<size_t>(large_simulated_time / 1s) * frame_rate;
+
+		scheduler::set_frame_budget(scheduler::pipeline::main, 0us);
+
+		std::mt19937 rng{static_cast<uint32_t>(task_count)};
+		std::uniform_int_distribution<int64_t> interval_distribution{1'000, 10'000};
+
+		uint64_t tasks_run = 0;
+
+		std::vector<scheduler::task_handle> tasks{};
+		tasks.reserve(task_count);
+
+		for (size_t i = 0; i < task_count; ++i)
+		{
+			tasks.emplace_back(scheduler::loop([&tasks_run]
+			{
+				++tasks_run;
+			}, scheduler::pipeline::main, std::chrono::milliseconds{interval_distribution(rng)}));
+		}
+
+		std::vector<uint64_t> frame_overheads{};
+		frame_overheads.reserve(frame_count);
+
+		for (size_t frame = 0; frame < frame_count; ++frame)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			scheduler::run_frame(scheduler::pipeline::main);
+			const auto end = std::chrono::steady_clock::now();
+
+			frame_overheads.emplace_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+			virtual_clock.advance(frame_time);
+		}
+
+		for (const auto& task : tasks)
+		{
+			task.cancel();
+		}
+
+		// Cancelled tasks are dropped once they come up, the longest interval flushes all of them
+		virtual_clock.advance(std::chrono::milliseconds{interval_distribution.max()});
+		scheduler::run_frame(scheduler::pipeline::main);
+
+		const auto total_overhead = get_mean(frame_overheads) * static_cast<double>(frame_overheads.size());
+
+		printf("%8zu %10.2f %10.2f %12.1f %10.1f\n", task_count,
+		       get_mean(frame_overheads) / 1'000.0,
+		       static_cast<double>(get_percentile(frame_overheads, 0.99)) / 1'000.0,
+		       static_cast<double>(tasks_run) / static_cast<double>(frame_count),
+		       tasks_run ? total_overhead / static_cast<double>(tasks_run) : 0.0);
+	}
+
+	// Schedules batches on the main pipeline and runs them with the next frame.
+	// The first batch is not measured, it grows the queues and state pools to their working size.
+	// Latency is measured separately with one task per frame, so it doesn't include the rest of the batch.
+	template <typename Schedule>
+	void run_api_benchmark(const char* name, Schedule&& schedule_task)
+	{
+		constexpr size_t batch_size = 1'000;
+		constexpr size_t batch_count = 100;
+
+		uint64_t allocations = 0;
+		uint64_t schedule_time = 0;
+
+		for (size_t batch = 0; batch <= batch_count; ++batch)
+		{
+			const auto allocations_before = allocation_count.load();
+			const auto start = std::chrono::steady_clock::now();
+
+			for (size_t i = 0; i < batch_size; ++i)
+			{
+				schedule_task([]
+				{
+				});
+			}
+
+			const auto end = std::chrono::steady_clock::now();
+			scheduler::run_frame(scheduler::pipeline::main);
+
+			if (batch > 0)
+			{
+				allocations += allocation_count.load() - allocations_before;
+				schedule_time += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			}
+		}
+
+		std::vector<uint64_t> latencies{};
+		latencies.reserve(batch_size * batch_count);
+
+		for (size_t i = 0; i < batch_size * batch_count; ++i)
+		{
+			schedule_task([&latencies, submitted = std::chrono::steady_clock::now()]
+			{
+				latencies.emplace_back((std::chrono::steady_clock::now() - submitted).count());
+			});
+
+			scheduler::run_frame(scheduler::pipeline::main);
+		}
+
+		const auto task_count = static_cast<double>(batch_size * batch_count);
+
+		printf("%-20s %12.3f %12.1f %12.1f %12.1f\n", name,
+		       static_cast<double>(allocations) / task_count,
+		       static_cast<double>(schedule_time) / task_count,
+		       get_mean(latencies),
+		       static_cast<double>(get_percentile(latencies, 0.99)));
+	}
+
+	void run_api_benchmarks()
+	{
+		scheduler::set_frame_budget(scheduler::pipeline::main, 0us);
+
+		printf("%-20s %12s %12s %12s %12s\n", "api", "allocs/task", "schedule ns", "latency ns", "p99 ns");
+
+		run_api_benchmark("schedule_detached", [](auto&& callback)
+		{
+			scheduler::schedule_detached([callback = std::move(callback)]
+			{
+				callback();
+				return scheduler::cond_end;
+			}, scheduler::pipeline::main);
+		});
+
+		run_api_benchmark("once", [](auto&& callback)
+		{
+			scheduler::once(std::move(callback), scheduler::pipeline::main);
+		});
+
+		std::vector<scheduler::task_handle> handles{};
+		handles.reserve(1'000);
+
+		// The handles are kept until the next batch, the states are released on reassignment
+		run_api_benchmark("once (kept handle)", [&handles](auto&& callback)
+		{
+			if (handles.size() == handles.capacity())
+			{
+				handles.clear();
+			}
+
+			handles.emplace_back(scheduler::once(std::move(callback), scheduler::pipeline::main));
+		});
+
+		run_api_benchmark("run", [](auto&& callback)
+		{
+			scheduler::run(std::move(callback), scheduler::pipeline::main);
+		});
+	}
+}
+
+int main()
+{
+	scheduler::set_clock(&virtual_clock);
+
+	printf("Simulating %lld s per scenario on the main pipeline, budget is half a frame\n\n",
+	       static_cast<long long>(simulated_time.count()));
+	printf("%6s %6s %6s %10s %10s %8s %10s %10s %10s %10s %9s\n", "hz", "tasks", "us", "frame us", "p99 us",
+	       "ns/task", "late ms", "p99 ms", "deferrals", "overruns", "fairness");
+
+	for (const auto frame_rate : {60u, 144u, 240u, 1000u})
+	{
+		for (const auto task_cost : {10us, 100us})
+		{
+			run_scenario({frame_rate, 64, 16, task_cost});
+		}
+	}
+
+	printf("\nRecurring tasks with 1-10 s intervals, 10 s at 60 Hz without a budget\n\n");
+	printf("%8s %10s %10s %12s %10s\n", "tasks", "frame us", "p99 us", "runs/frame", "ns/run");
+
+	for (const auto task_count : {1'000u, 10'000u, 100'000u})
+	{
+		run_large_scenario(task_count);
+	}
+
+	scheduler::set_clock(nullptr);
+
+	printf("\n");
+	run_api_benchmarks();
+
+	printf("\n");
+	benchmark::run_container_benchmarks();
+
+	return 0;
+}
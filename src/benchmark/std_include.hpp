@@ -0,0 +1,19 @@
+#pragma once
+
+// Portable replacement for the client's precompiled header.
+// Only what the scheduler needs, so it builds without the Windows SDK.
+
+#include <map>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <variant>
+#include <cassert>
+
+using namespace std::literals;
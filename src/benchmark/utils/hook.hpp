@@ -0,0 +1,15 @@
+#pragma once
+
+namespace utils::hook
+{
+	// The game hooks are never installed, run_frame drives the pipelines instead
+	class detour
+	{
+	public:
+		template <typename T = void, typename... Args>
+		T invoke(Args...)
+		{
+			return T();
+		}
+	};
+}
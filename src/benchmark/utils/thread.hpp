@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <thread>
+
+namespace utils::thread
+{
+	template <typename ...Args>
+	std::thread create_named_thread(const std::string& /*name*/, Args&&... args)
+	{
+		return std::thread(std::forward<Args>(args)...);
+	}
+}
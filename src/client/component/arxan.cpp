@@ -113,20 +113,32 @@ namespace arxan
 			return create_mutex_ex_a_hook.invoke<HANDLE>(attributes, name, flags, access);
 		}
 
+		constexpr std::string_view evil_keywords[] =
+		{
+			"IDA",
+			"ida",
+			"HxD",
+			"cheatengine",
+			"Cheat Engine",
+			"x96dbg",
+			"x32dbg",
+			"x64dbg",
+			"Wireshark",
+		};
+
 		bool remove_evil_keywords_from_string(const UNICODE_STRING& string)
 		{
-			static const std::wstring evil_keywords[] =
-			{
-				L"IDA",
-				L"ida",
-				L"HxD",
-				L"cheatengine",
-				L"Cheat Engine",
-				L"x96dbg",
-				L"x32dbg",
-				L"x64dbg",
-				L"Wireshark",
-			};
+			// The keywords are ASCII, so widening them unit by unit is exact
+			static const auto wide_evil_keywords = []
+			{
+				std::vector<std::wstring> keywords{};
+				for (const auto& keyword : evil_keywords)
+				{
+					keywords.emplace_back(keyword.begin(), keyword.end());
+				}
+
+				return keywords;
+			}();
 
 			if (!string.Buffer || !string.Length)
 			{
@@ -136,7 +148,7 @@ namespace arxan
 			std::wstring_view path(string.Buffer, string.Length / sizeof(string.Buffer[0]));
 
 			bool modified = false;
-			for (const auto& keyword : evil_keywords)
+			for (const auto& keyword : wide_evil_keywords)
 			{
 				while (true)
 				{
@@ -168,20 +180,33 @@ namespace arxan
 			return remove_evil_keywords_from_string(unicode_string);
 		}
 
+		// ASCII bytes never occur inside multibyte sequences, so the narrow string can be searched in place
 		bool remove_evil_keywords_from_string(char* str, const size_t length)
 		{
-			std::string_view str_view(str, length);
-			std::wstring wstr(str_view.begin(), str_view.end());
-
-			if (!remove_evil_keywords_from_string(&wstr[0], wstr.size()))
+			if (!str || !length)
 			{
 				return false;
 			}
 
-			const std::string regular_str(wstr.begin(), wstr.end());
-			memcpy(str, regular_str.data(), length);
+			const std::string_view str_view(str, length);
 
-			return true;
+			bool modified = false;
+			for (const auto& keyword : evil_keywords)
+			{
+				while (true)
+				{
+					const auto pos = str_view.find(keyword);
+					if (pos == std::string_view::npos)
+					{
+						break;
+					}
+
+					modified = true;
+					memset(str + pos, 'a', keyword.size());
+				}
+			}
+
+			return modified;
 		}
 
 
@@ -431,7 +456,7 @@ namespace arxan
 
 			if (!context)
 			{
-				OutputDebugStringA(utils::string::va("Unable to find frame offset for: %llX", return_address));
+				OutputDebugStringA(utils::string::va_format("Unable to find frame offset for: {:X}", return_address));
 				return current_checksum;
 			}
 
@@ -440,8 +465,8 @@ namespace arxan
 
 			/*if (current_checksum != correct_checksum)
 			{
-				OutputDebugStringA(utils::string::va("Adjusting checksum (%llX): %X -> %X", handler_address,
-				                                     current_checksum, correct_checksum));
+				OutputDebugStringA(utils::string::va_format("Adjusting checksum ({:X}): {:X} -> {:X}", handler_address,
+				                                            current_checksum, correct_checksum));
 			}*/
 
 			return correct_checksum;
@@ -623,10 +648,10 @@ namespace arxan
 	                                     PVOID* function_address, const BOOL b_value,
 	                                     PVOID* callback_address)
 	{
-		OutputDebugStringA(utils::string::va("Proc: %s %X\n",
-		                                     (function_name && function_name->Buffer)
-			                                     ? function_name->Buffer
-			                                     : "(null)", static_cast<DWORD>(oridinal)));
+		OutputDebugStringA(utils::string::va_format("Proc: {} {:X}\n",
+		                                            (function_name && function_name->Buffer)
+			                                            ? function_name->Buffer
+			                                            : "(null)", static_cast<DWORD>(oridinal)));
 
 		return get_proc_address_hook.invoke<NTSTATUS>(module_handle, function_name, oridinal, function_address, b_value,
 		                                              callback_address);
@@ -0,0 +1,16 @@
+#include <std_include.hpp>
+#include "command.hpp"
+
+#include "game/game.hpp"
+
+#include <utils/memory.hpp>
+
+namespace command
+{
+	void add(const char* name, void (*function)())
+	{
+		// The game links the entry into its command list, so it must stay alive
+		auto* cmd_function = utils::memory::get_allocator()->allocate<game::cmd_function_s>();
+		game::Cmd_AddCommandInternal(name, function, cmd_function);
+	}
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace command
+{
+	void add(const char* name, void (*function)());
+}
@@ -0,0 +1,56 @@
+#include <std_include.hpp>
+
+#ifdef LOCK_INSTRUMENTATION
+
+#include "loader/component_loader.hpp"
+
+#include "command.hpp"
+
+#include "game/game.hpp"
+
+#include <utils/concurrency.hpp>
+
+namespace lock_stats
+{
+	namespace
+	{
+		void print_lock_stats()
+		{
+			std::vector<const utils::concurrency::lock_stats*> entries{};
+			utils::concurrency::for_each_lock_stats([&](const utils::concurrency::lock_stats& stats)
+			{
+				entries.emplace_back(&stats);
+			});
+
+			std::ranges::sort(entries, [](const auto* a, const auto* b)
+			{
+				return a->total_wait.load(std::memory_order_relaxed) > b->total_wait.load(std::memory_order_relaxed);
+			});
+
+			game::Com_Printf(0, 0, "%12s %12s %10s %10s  %s\n", "locks", "contended", "wait ms", "max us", "name");
+
+			for (const auto* stats : entries)
+			{
+				game::Com_Printf(0, 0, "%12llu %12llu %10.2f %10.1f  %s\n",
+				                 stats->acquisitions.load(std::memory_order_relaxed),
+				                 stats->contended.load(std::memory_order_relaxed),
+				                 static_cast<double>(stats->total_wait.load(std::memory_order_relaxed)) / 1'000'000.0,
+				                 static_cast<double>(stats->max_wait.load(std::memory_order_relaxed)) / 1'000.0,
+				                 stats->name.data());
+			}
+		}
+	}
+
+	class component final : public component_interface
+	{
+	public:
+		void post_unpack() override
+		{
+			command::add("lock_stats", print_lock_stats);
+		}
+	};
+}
+
+REGISTER_COMPONENT(lock_stats::component)
+
+#endif
@@ -2,97 +2,883 @@
 #include "loader/component_loader.hpp"
 
 #include "scheduler.hpp"
+#include "command.hpp"
+
+#include "game/game.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
 #include <utils/hook.hpp>
 #include <utils/concurrency.hpp>
 #include <utils/thread.hpp>
 
-namespace scheduler
-{
-	namespace
-	{
-		struct task
-		{
-			std::function<bool()> handler{};
-			std::chrono::milliseconds interval{};
-			std::chrono::high_resolution_clock::time_point last_call{};
-		};
+namespace scheduler
+{
+	namespace
+	{
+		class real_clock final : public clock
+		{
+		public:
+			time_point now() const override
+			{
+				return std::chrono::high_resolution_clock::now();
+			}
+		};
+
+		const real_clock default_clock{};
+		std::atomic<const clock*> active_clock{&default_clock};
+
+		clock::time_point get_time()
+		{
+			return active_clock.load(std::memory_order_relaxed)->now();
+		}
+
+		// Accumulated per scheduling site, written lock-free by whichever thread runs the task
+		struct task_stats
+		{
+			// Runtime histogram with log2 nanosecond buckets, used to estimate the p99
+			static constexpr size_t bucket_count = 64;
+
+			std::source_location location{};
+			task_stats* next{};
+
+			std::atomic<uint64_t> executions{0};
+			std::atomic<uint64_t> total_time{0};
+			std::atomic<uint64_t> max_time{0};
+			std::atomic<uint64_t> total_lateness{0};
+			std::atomic<uint64_t> max_lateness{0};
+			std::atomic<uint64_t> histogram[bucket_count]{};
+
+			static void update_max(std::atomic<uint64_t>& value, const uint64_t candidate)
+			{
+				auto current = value.load(std::memory_order_relaxed);
+				while (current < candidate && !value.compare_exchange_weak(current, candidate,
+				                                                           std::memory_order_relaxed))
+				{
+				}
+			}
+
+			void record(const std::chrono::nanoseconds runtime, const std::chrono::nanoseconds lateness)
+			{
+				const auto time = static_cast<uint64_t>(std::max(runtime, 0ns).count());
+				const auto late = static_cast<uint64_t>(std::max(lateness, 0ns).count());
+
+				this->executions.fetch_add(1, std::memory_order_relaxed);
+				this->total_time.fetch_add(time, std::memory_order_relaxed);
+				this->total_lateness.fetch_add(late, std::memory_order_relaxed);
+				update_max(this->max_time, time);
+				update_max(this->max_lateness, late);
+
+				size_t bucket = 0;
+				while (bucket < (bucket_count - 1) && (1ull << bucket) < time)
+				{
+					++bucket;
+				}
+
+				this->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+			}
+
+			uint64_t get_p99_time() const
+			{
+				const auto count = this->executions.load(std::memory_order_relaxed);
+				const auto threshold = count - count / 100;
+
+				uint64_t seen = 0;
+				for (size_t i = 0; i < bucket_count; ++i)
+				{
+					seen += this->histogram[i].load(std::memory_order_relaxed);
+					if (seen >= threshold)
+					{
+						return 1ull << i;
+					}
+				}
+
+				return this->max_time.load(std::memory_order_relaxed);
+			}
+		};
+
+		// Append-only list, entries live as long as the pipeline
+		class task_stats_registry
+		{
+		public:
+			task_stats_registry() = default;
+
+			~task_stats_registry()
+			{
+				auto* entry = this->head_.load();
+				while (entry)
+				{
+					auto* next = entry->next;
+					delete entry;
+					entry = next;
+				}
+			}
+
+			task_stats_registry(task_stats_registry&&) = delete;
+			task_stats_registry(const task_stats_registry&) = delete;
+			task_stats_registry& operator=(task_stats_registry&&) = delete;
+			task_stats_registry& operator=(const task_stats_registry&) = delete;
+
+			task_stats* get(const std::source_location& location)
+			{
+				auto* head = this->head_.load(std::memory_order_acquire);
+
+				while (true)
+				{
+					for (auto* entry = head; entry; entry = entry->next)
+					{
+						if (is_same_location(entry->location, location))
+						{
+							return entry;
+						}
+					}
+
+					auto* entry = new task_stats{};
+					entry->location = location;
+					entry->next = head;
+
+					if (this->head_.compare_exchange_weak(head, entry, std::memory_order_acq_rel,
+					                                      std::memory_order_acquire))
+					{
+						return entry;
+					}
+
+					// Someone else inserted, the site might be there now
+					delete entry;
+				}
+			}
+
+			template <typename F>
+			void for_each(F&& callback) const
+			{
+				for (auto* entry = this->head_.load(std::memory_order_acquire); entry; entry = entry->next)
+				{
+					callback(*entry);
+				}
+			}
+
+		private:
+			std::atomic<task_stats*> head_{nullptr};
+
+			static bool is_same_location(const std::source_location& a, const std::source_location& b)
+			{
+				// File names of one translation unit share the same string, so mostly the pointer check decides
+				return a.line() == b.line() && a.column() == b.column()
+					&& (a.file_name() == b.file_name() || strcmp(a.file_name(), b.file_name()) == 0);
+			}
+		};
+
+		std::atomic_bool profiling_enabled{false};
+
+		struct task
+		{
+			task_handler handler{};
+			std::chrono::milliseconds interval{};
+			clock::time_point next_call{};
+			priority prio{priority::normal};
+			std::source_location location{};
+
+			// Duration of the last budgeted run, decides whether the task fits into the remaining budget
+			clock::duration runtime{};
+
+			// Looked up on the first profiled run, scheduling doesn't touch the registry
+			task_stats* stats{};
+
+			// Only tasks that can be observed or depended on have a state
+			std::shared_ptr<detail::task_state> state{};
+
+			bool is_cancelled() const
+			{
+				return this->state && this->state->is_cancelled();
+			}
+
+			void finish() const
+			{
+				if (this->state)
+				{
+					this->state->finish();
+				}
+			}
+
+			void cancel() const
+			{
+				if (this->state)
+				{
+					this->state->cancel();
+				}
+			}
+		};
+
+		bool run_task(task& task, task_stats_registry& registry)
+		{
+			if (!profiling_enabled.load(std::memory_order_relaxed))
+			{
+				return task.handler();
+			}
+
+			if (!task.stats)
+			{
+				task.stats = registry.get(task.location);
+			}
+
+			const auto start = get_time();
+			const auto res = task.handler();
+			const auto end = get_time();
+
+			task.stats->record(end - start, start - task.next_call);
+			return res;
+		}
+
+		// Orders the task list as a min-heap on the next due time
+		struct task_compare
+		{
+			bool operator()(const task& a, const task& b) const
+			{
+				return a.next_call > b.next_call;
+			}
+		};
+
+		using task_list = std::vector<task>;
+
+		// Due tasks of one priority in due order, consumed from the front.
+		// Tasks that don't fit into a frame stay in place instead of going back into the heap.
+		class task_backlog
+		{
+		public:
+			bool empty() const
+			{
+				return this->next_ == this->tasks_.size();
+			}
+
+			size_t size() const
+			{
+				return this->tasks_.size() - this->next_;
+			}
+
+			const task& front() const
+			{
+				return this->tasks_[this->next_];
+			}
+
+			task take()
+			{
+				return std::move(this->tasks_[this->next_++]);
+			}
+
+			void add(task&& task)
+			{
+				this->tasks_.emplace_back(std::move(task));
+			}
+
+			// Only drops the consumed tasks once they outnumber the remaining ones,
+			// so every task is moved a constant number of times on average
+			void compact()
+			{
+				if (this->next_ * 2 < this->tasks_.size())
+				{
+					return;
+				}
+
+				this->tasks_.erase(this->tasks_.begin(), this->tasks_.begin() + static_cast<ptrdiff_t>(this->next_));
+				this->next_ = 0;
+			}
+
+			template <typename F>
+			void for_each(F&& callback) const
+			{
+				for (auto i = this->next_; i < this->tasks_.size(); ++i)
+				{
+					callback(this->tasks_[i]);
+				}
+			}
+
+			void clear()
+			{
+				this->tasks_.clear();
+				this->next_ = 0;
+			}
+
+		private:
+			task_list tasks_{};
+			size_t next_{};
+		};
+
+		constexpr auto priority_count = static_cast<size_t>(priority::low) + 1;
+
+		thread_local std::optional<pipeline> current_pipeline{};
+
+		class task_pipeline
+		{
+		public:
+			void add(task&& task)
+			{
+				new_callbacks_.push(std::move(task));
+			}
+
+			// Must only be called from the thread owning the pipeline
+			void execute()
+			{
+				const std::chrono::microseconds budget{this->budget_.load(std::memory_order_relaxed)};
+				if (budget.count() > 0 || this->has_backlog())
+				{
+					this->execute_budgeted(budget);
+				}
+				else
+				{
+					this->execute_all();
+				}
+
+				++this->frames_;
+			}
+
+			void set_budget(const std::chrono::microseconds budget)
+			{
+				this->budget_ = budget.count();
+			}
+
+			frame_stats get_stats() const
+			{
+				frame_stats stats{};
+				stats.frames = this->frames_;
+				stats.deferrals = this->deferrals_;
+				stats.overruns = this->overruns_;
+				return stats;
+			}
+
+			// Moves all tasks due at the given time out of the pipeline
+			void collect_due(const clock::time_point now, task_list& due_tasks)
+			{
+				this->merge_callbacks();
+
+				auto& tasks = this->callbacks_;
+				while (!tasks.empty() && tasks.front().next_call <= now)
+				{
+					std::pop_heap(tasks.begin(), tasks.end(), task_compare{});
+					due_tasks.emplace_back(std::move(tasks.back()));
+					tasks.pop_back();
+				}
+			}
+
+			task_stats_registry& get_task_stats()
+			{
+				return this->stats_;
+			}
+
+			// Drops all pending tasks, so nobody keeps waiting for them
+			void cancel_all()
+			{
+				this->merge_callbacks(std::numeric_limits<size_t>::max());
+
+				for (const auto& task : this->callbacks_)
+				{
+					task.cancel();
+				}
+
+				this->callbacks_.clear();
+
+				for (auto& backlog : this->backlogs_)
+				{
+					backlog.for_each([](const task& task)
+					{
+						task.cancel();
+					});
+
+					backlog.clear();
+				}
+			}
+
+			// Must only be called from the thread owning the pipeline
+			bool has_new_tasks() const
+			{
+				return !this->new_callbacks_.empty();
+			}
+
+			std::optional<clock::time_point> get_next_due() const
+			{
+				if (this->callbacks_.empty())
+				{
+					return {};
+				}
+
+				return this->callbacks_.front().next_call;
+			}
+
+		private:
+			static constexpr size_t max_merge_batch = 4096;
+
+			utils::concurrency::mpsc_queue<task> new_callbacks_;
+			task_list callbacks_;
+			task_list due_tasks_;
+			task_backlog backlogs_[priority_count];
+			task_stats_registry stats_;
+
+			std::atomic<int64_t> budget_{0};
+			std::atomic<uint64_t> frames_{0};
+			std::atomic<uint64_t> deferrals_{0};
+			std::atomic<uint64_t> overruns_{0};
+
+			void insert(task&& task)
+			{
+				this->callbacks_.emplace_back(std::move(task));
+				std::push_heap(this->callbacks_.begin(), this->callbacks_.end(), task_compare{});
+			}
+
+			bool has_backlog() const
+			{
+				return std::ranges::any_of(this->backlogs_, [](const task_backlog& backlog)
+				{
+					return !backlog.empty();
+				});
+			}
+
+			void complete(task&& task, const bool res, const clock::time_point now)
+			{
+				if (res == cond_end)
+				{
+					task.finish();
+					return;
+				}
+
+				task.next_call = now + task.interval;
+				this->insert(std::move(task));
+			}
+
+			// Runs everything that is due, in due order
+			void execute_all()
+			{
+				// Reuse the buffer, but stay safe in case a task re-enters the pipeline
+				auto due_tasks = std::move(this->due_tasks_);
+
+				const auto now = get_time();
+				this->collect_due(now, due_tasks);
+
+				for (auto& task : due_tasks)
+				{
+					if (!task.is_cancelled())
+					{
+						const auto res = run_task(task, this->stats_);
+						this->complete(std::move(task), res, now);
+					}
+				}
+
+				due_tasks.clear();
+				this->due_tasks_ = std::move(due_tasks);
+			}
+
+			// Runs due tasks by priority until the next one doesn't fit into the budget anymore.
+			// Whatever is left stays in the backlogs and runs first next frame, only critical tasks ignore the budget.
+			void execute_budgeted(const std::chrono::microseconds budget)
+			{
+				auto due_tasks = std::move(this->due_tasks_);
+
+				const auto now = get_time();
+				this->collect_due(now, due_tasks);
+
+				for (auto& task : due_tasks)
+				{
+					this->backlogs_[static_cast<size_t>(task.prio)].add(std::move(task));
+				}
+
+				due_tasks.clear();
+				this->due_tasks_ = std::move(due_tasks);
+
+				auto last_end = now;
+				auto has_run = false;
+				auto exhausted = false;
+
+				for (auto& backlog : this->backlogs_)
+				{
+					while (!backlog.empty())
+					{
+						const auto& next = backlog.front();
+						if (next.is_cancelled())
+						{
+							backlog.take();
+							continue;
+						}
+
+						// Tasks that never ran are assumed to be cheap, but only start while there is budget left.
+						// A task that takes longer than the whole budget still runs when it comes first.
+						const auto elapsed = last_end - now;
+						const auto fits = budget.count() <= 0 || !has_run || (elapsed < budget && elapsed + next.runtime <= budget);
+						if (next.prio != priority::critical && (exhausted || !fits))
+						{
+							exhausted = true;
+							break;
+						}
+
+						has_run = true;
+						auto task = backlog.take();
+						const auto res = run_task(task, this->stats_);
+
+						const auto end = get_time();
+						task.runtime = end - last_end;
+						last_end = end;
+
+						this->complete(std::move(task), res, now);
+					}
+				}
+
+				for (auto& backlog : this->backlogs_)
+				{
+					this->deferrals_ += backlog.size();
+					backlog.compact();
+				}
+
+				if (budget.count() > 0 && last_end - now > budget)
+				{
+					++this->overruns_;
+				}
+			}
+
+			// Producers can outpace the single consumer, so one call only takes a bounded batch.
+			// Anything left over is merged on the next call.
+			void merge_callbacks(const size_t limit = max_merge_batch)
+			{
+				for (size_t i = 0; i < limit; ++i)
+				{
+					auto task = new_callbacks_.pop();
+					if (!task)
+					{
+						break;
+					}
+
+					this->insert(std::move(*task));
+				}
+			}
+		};
+
+		// Runs an asynchronous pipeline on a pool of worker threads.
+		// The dispatcher owns the pipeline and sleeps until the next task is due
+		// or until a new task is submitted.
+		class task_executor
+		{
+		public:
+			task_executor(task_pipeline& pipeline, const scheduler::pipeline type, std::string name,
+			              const size_t worker_count)
+				: pipeline_(&pipeline)
+				  , type_(type)
+				  , name_(std::move(name))
+				  , worker_count_(worker_count)
+			{
+			}
+
+			~task_executor()
+			{
+				this->stop();
+			}
+
+			task_executor(task_executor&&) = delete;
+			task_executor(const task_executor&) = delete;
+			task_executor& operator=(task_executor&&) = delete;
+			task_executor& operator=(const task_executor&) = delete;
+
+			void start()
+			{
+				std::lock_guard _(this->control_mutex_);
+				this->start_threads();
+			}
+
+			// Pending tasks are cancelled, they won't run anymore
+			void stop()
+			{
+				std::lock_guard _(this->control_mutex_);
+				this->join_threads();
+
+				// Only now the dispatcher is gone and the pipeline can be drained from here
+				std::lock_guard __(this->cancel_mutex_);
+				this->stopped_ = true;
+				this->cancel_pending();
+			}
+
+			// Resizing waits for running tasks to finish, pending ones are kept
+			void set_worker_count(const size_t worker_count)
+			{
+				// A worker would have to join itself
+				if (current_pipeline == this->type_)
+				{
+					throw std::runtime_error("Can't resize a worker pool from one of its own tasks");
+				}
+
+				std::lock_guard _(this->control_mutex_);
+
+				const auto running = this->dispatcher_.joinable();
+				if (running)
+				{
+					this->join_threads();
+				}
+
+				this->worker_count_ = std::max<size_t>(worker_count, 1);
 
-		using task_list = std::vector<task>;
+				if (running)
+				{
+					this->start_threads();
+				}
+			}
 
-		class task_pipeline
-		{
-		public:
-			void add(task&& task)
+			// Called for every task added to the pipeline, a stopped executor cancels it right away
+			void submitted()
+			{
+				if (this->stopped_)
+				{
+					std::lock_guard _(this->cancel_mutex_);
+					if (this->stopped_)
+					{
+						this->cancel_pending();
+						return;
+					}
+				}
+
+				this->notify();
+			}
+
+			void notify()
+			{
+				{
+					std::lock_guard _(this->wakeup_mutex_);
+					this->woken_ = true;
+				}
+
+				this->wakeup_condition_.notify_one();
+			}
+
+		private:
+			// Recurring tasks without delay would otherwise spin a worker
+			static constexpr auto min_interval = 10ms;
+
+			task_pipeline* pipeline_{};
+			scheduler::pipeline type_{};
+			std::string name_{};
+			size_t worker_count_{};
+
+			std::atomic_bool kill_{false};
+			std::thread dispatcher_{};
+			std::vector<std::thread> workers_{};
+
+			std::mutex wakeup_mutex_{};
+			std::condition_variable wakeup_condition_{};
+			bool woken_{false};
+
+			std::mutex work_mutex_{};
+			std::condition_variable work_condition_{};
+			std::deque<task> work_{};
+
+			// Serializes starting, stopping and resizing
+			std::mutex control_mutex_{};
+
+			// Set once stopped and joined, only changed while holding the cancel mutex
+			std::atomic_bool stopped_{false};
+			std::mutex cancel_mutex_{};
+
+			void start_threads()
 			{
-				new_callbacks_.access([&task](task_list& tasks)
 				{
-					tasks.emplace_back(std::move(task));
+					std::lock_guard _(this->cancel_mutex_);
+					this->stopped_ = false;
+				}
+
+				this->kill_ = false;
+
+				for (size_t i = 0; i < this->worker_count_; ++i)
+				{
+					this->workers_.emplace_back(utils::thread::create_named_thread(
+						this->name_ + " Worker " + std::to_string(i), [this]
+						{
+							this->work();
+						}));
+				}
+
+				this->dispatcher_ = utils::thread::create_named_thread(this->name_ + " Scheduler", [this]
+				{
+					this->dispatch();
 				});
 			}
 
-			void execute()
+			// Must hold the cancel mutex with no dispatcher running
+			void cancel_pending()
 			{
-				callbacks_.access([&](task_list& tasks)
+				std::deque<task> work{};
+
+				{
+					std::lock_guard _(this->work_mutex_);
+					work = std::move(this->work_);
+				}
+
+				for (const auto& task : work)
+				{
+					task.cancel();
+				}
+
+				this->pipeline_->cancel_all();
+			}
+
+			void join_threads()
+			{
+				{
+					std::lock_guard _(this->wakeup_mutex_);
+					std::lock_guard __(this->work_mutex_);
+					this->kill_ = true;
+				}
+
+				this->wakeup_condition_.notify_all();
+				this->work_condition_.notify_all();
+
+				if (this->dispatcher_.joinable())
 				{
-					this->merge_callbacks();
+					this->dispatcher_.join();
+				}
 
-					for (auto i = tasks.begin(); i != tasks.end();)
+				for (auto& worker : this->workers_)
+				{
+					if (worker.joinable())
 					{
-						const auto now = std::chrono::high_resolution_clock::now();
-						const auto diff = now - i->last_call;
+						worker.join();
+					}
+				}
+
+				this->workers_.clear();
+			}
+
+			void dispatch()
+			{
+				task_list due_tasks{};
+
+				while (!this->kill_)
+				{
+					this->pipeline_->collect_due(get_time(), due_tasks);
 
-						if (diff < i->interval)
+					if (!due_tasks.empty())
+					{
 						{
-							++i;
-							continue;
+							std::lock_guard _(this->work_mutex_);
+							for (auto& task : due_tasks)
+							{
+								this->work_.emplace_back(std::move(task));
+							}
 						}
 
-						i->last_call = now;
+						this->work_condition_.notify_all();
+						due_tasks.clear();
+					}
+
+					// Submissions beyond the merge batch are still queued
+					if (this->pipeline_->has_new_tasks())
+					{
+						continue;
+					}
+
+					std::unique_lock lock(this->wakeup_mutex_);
+					const auto is_woken = [this]
+					{
+						return this->woken_ || this->kill_;
+					};
+
+					const auto next_due = this->pipeline_->get_next_due();
+					if (next_due)
+					{
+						// Relative wait, the active clock might not be tied to the system time
+						this->wakeup_condition_.wait_for(lock, *next_due - get_time(), is_woken);
+					}
+					else
+					{
+						this->wakeup_condition_.wait(lock, is_woken);
+					}
+
+					this->woken_ = false;
+				}
+			}
+
+			void work()
+			{
+				current_pipeline = this->type_;
+
+				while (true)
+				{
+					task task{};
 
-						const auto res = i->handler();
-						if (res == cond_end)
+					{
+						std::unique_lock lock(this->work_mutex_);
+						this->work_condition_.wait(lock, [this]
 						{
-							i = tasks.erase(i);
-						}
-						else
+							return this->kill_ || !this->work_.empty();
+						});
+
+						if (this->kill_)
 						{
-							++i;
+							return;
 						}
+
+						task = std::move(this->work_.front());
+						this->work_.pop_front();
 					}
-				});
-			}
 
-		private:
-			utils::concurrency::container<task_list> new_callbacks_;
-			utils::concurrency::container<task_list, std::recursive_mutex> callbacks_;
+					if (task.is_cancelled())
+					{
+						continue;
+					}
 
-			void merge_callbacks()
-			{
-				callbacks_.access([&](task_list& tasks)
-				{
-					new_callbacks_.access([&](task_list& new_tasks)
+					const auto start = get_time();
+					const auto res = run_task(task, this->pipeline_->get_task_stats());
+					if (res == cond_end)
 					{
-						tasks.insert(tasks.end(), std::move_iterator<task_list::iterator>(new_tasks.begin()),
-						             std::move_iterator<task_list::iterator>(new_tasks.end()));
-						new_tasks = {};
-					});
-				});
+						task.finish();
+						continue;
+					}
+
+					task.next_call = start + std::max(task.interval, std::chrono::milliseconds(min_interval));
+					this->pipeline_->add(std::move(task));
+					this->notify();
+				}
 			}
 		};
 
-		volatile bool kill = false;
-		std::thread thread;
 		task_pipeline pipelines[pipeline::count];
+
+		task_executor async_executor{pipelines[pipeline::async], pipeline::async, "Async", 2};
+		task_executor blocking_executor{pipelines[pipeline::blocking], pipeline::blocking, "Blocking", 4};
+
+		task_executor* get_executor(const pipeline type)
+		{
+			switch (type)
+			{
+			case pipeline::async:
+				return &async_executor;
+			case pipeline::blocking:
+				return &blocking_executor;
+			default:
+				return nullptr;
+			}
+		}
+
 		utils::hook::detour r_end_frame_hook;
 		utils::hook::detour g_run_frame_hook;
 		utils::hook::detour main_frame_hook;
 
+		void enqueue(const pipeline type, task&& task)
+		{
+			task.next_call = get_time() + task.interval;
+			pipelines[type].add(std::move(task));
+
+			auto* executor = get_executor(type);
+			if (executor)
+			{
+				executor->submitted();
+			}
+		}
+
 		void execute(const pipeline type)
 		{
 			assert(type >= 0 && type < pipeline::count);
+
+			const auto previous_pipeline = current_pipeline;
+			current_pipeline = type;
+
 			pipelines[type].execute();
+
+			current_pipeline = previous_pipeline;
 		}
 
 		void r_end_frame_stub()
@@ -114,37 +900,290 @@ namespace scheduler
 		}
 	}
 
-	void schedule(const std::function<bool()>& callback, const pipeline type,
-	              const std::chrono::milliseconds delay)
+	namespace detail
 	{
-		assert(type >= 0 && type < pipeline::count);
+		task_state::~task_state()
+		{
+			auto* entry = this->continuations_.load();
+			while (entry && entry != get_closed_marker())
+			{
+				auto* next = entry->next;
+				delete entry;
+				entry = next;
+			}
+		}
+
+		bool task_state::cancel()
+		{
+			auto expected = static_cast<uint8_t>(pending);
+			if (!this->status_.compare_exchange_strong(expected, cancelled, std::memory_order_acq_rel))
+			{
+				return false;
+			}
+
+			this->complete();
+			return true;
+		}
+
+		void task_state::finish()
+		{
+			auto expected = static_cast<uint8_t>(pending);
+			if (this->status_.compare_exchange_strong(expected, finished, std::memory_order_acq_rel))
+			{
+				this->complete();
+			}
+		}
+
+		void task_state::wait() const
+		{
+			this->status_.wait(pending, std::memory_order_acquire);
+		}
+
+		bool task_state::is_done() const
+		{
+			return this->status_.load(std::memory_order_acquire) != pending;
+		}
+
+		bool task_state::is_finished() const
+		{
+			return this->status_.load(std::memory_order_acquire) == finished;
+		}
+
+		bool task_state::is_cancelled() const
+		{
+			return this->status_.load(std::memory_order_acquire) == cancelled;
+		}
+
+		void task_state::on_done(utils::unique_function<void()>&& callback)
+		{
+			auto* entry = new continuation{};
+			entry->callback = std::move(callback);
+
+			auto* head = this->continuations_.load(std::memory_order_acquire);
+
+			do
+			{
+				if (head == get_closed_marker())
+				{
+					entry->callback();
+					delete entry;
+					return;
+				}
+
+				entry->next = head;
+			}
+			while (!this->continuations_.compare_exchange_weak(head, entry, std::memory_order_acq_rel,
+			                                                   std::memory_order_acquire));
+		}
+
+		void task_state::complete()
+		{
+			this->status_.notify_all();
+
+			auto* entry = this->continuations_.exchange(get_closed_marker(), std::memory_order_acq_rel);
+
+			// Run continuations in the order they were registered
+			continuation* reversed = nullptr;
+			while (entry)
+			{
+				auto* next = entry->next;
+				entry->next = reversed;
+				reversed = entry;
+				entry = next;
+			}
+
+			while (reversed)
+			{
+				auto* next = reversed->next;
+				reversed->callback();
+				delete reversed;
+				reversed = next;
+			}
+		}
+
+		task_state::continuation* task_state::get_closed_marker()
+		{
+			static continuation marker{};
+			return &marker;
+		}
+
+		void submit(std::shared_ptr<task_state> state, task_handler&& callback, const pipeline type,
+		            const std::chrono::milliseconds delay, const priority prio,
+		            const std::vector<task_handle>& dependencies, const std::source_location& location)
+		{
+			assert(type >= 0 && type < pipeline::count);
+
+			task task;
+			task.handler = std::move(callback);
+			task.interval = delay;
+			task.prio = prio;
+			task.location = location;
+			task.state = std::move(state);
+
+			if (dependencies.empty())
+			{
+				enqueue(type, std::move(task));
+				return;
+			}
+
+			struct pending_task
+			{
+				scheduler::task task{};
+				pipeline type{};
+				std::atomic<size_t> remaining{};
+			};
+
+			auto pending = std::make_shared<pending_task>();
+			pending->task = std::move(task);
+			pending->type = type;
+			pending->remaining = dependencies.size();
+
+			for (const auto& dependency : dependencies)
+			{
+				const auto on_dependency_done = [pending, dependency_state = dependency.get_state().get()]
+				{
+					auto& state = *pending->task.state;
+					if (dependency_state && dependency_state->is_cancelled())
+					{
+						state.cancel();
+					}
+
+					if (pending->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && !state.is_cancelled())
+					{
+						enqueue(pending->type, std::move(pending->task));
+					}
+				};
+
+				if (dependency.get_state())
+				{
+					dependency.get_state()->on_done(on_dependency_done);
+				}
+				else
+				{
+					on_dependency_done();
+				}
+			}
+		}
+	}
 
-		task task;
-		task.handler = callback;
-		task.interval = delay;
-		task.last_call = std::chrono::high_resolution_clock::now();
+	task_handle schedule(task_handler&& callback, const pipeline type,
+	                     const std::chrono::milliseconds delay, const priority prio,
+	                     const std::source_location& location)
+	{
+		auto state = detail::make_state<detail::task_state>();
+		detail::submit(state, std::move(callback), type, delay, prio, {}, location);
+		return state;
+	}
 
-		pipelines[type].add(std::move(task));
+	void schedule_detached(task_handler&& callback, const pipeline type,
+	                       const std::chrono::milliseconds delay, const priority prio,
+	                       const std::source_location& location)
+	{
+		detail::submit({}, std::move(callback), type, delay, prio, {}, location);
 	}
 
-	void loop(const std::function<void()>& callback, const pipeline type,
-	          const std::chrono::milliseconds delay)
+	void set_worker_count(const pipeline type, const size_t count)
 	{
-		schedule([callback]()
+		auto* executor = get_executor(type);
+		assert(executor);
+
+		if (executor)
 		{
-			callback();
-			return cond_continue;
-		}, type, delay);
+			executor->set_worker_count(count);
+		}
+	}
+
+	clock::time_point virtual_clock::now() const
+	{
+		return time_point{duration{this->time_.load(std::memory_order_acquire)}};
+	}
+
+	void virtual_clock::advance(const duration delta)
+	{
+		this->time_.fetch_add(delta.count(), std::memory_order_acq_rel);
+
+		async_executor.notify();
+		blocking_executor.notify();
+	}
+
+	void set_clock(const clock* clock)
+	{
+		active_clock = clock ? clock : &default_clock;
+
+		async_executor.notify();
+		blocking_executor.notify();
+	}
+
+	void run_frame(const pipeline type)
+	{
+		assert(!get_executor(type));
+		execute(type);
+	}
+
+	bool is_current_pipeline(const pipeline type)
+	{
+		return current_pipeline == type;
+	}
+
+	void set_frame_budget(const pipeline type, const std::chrono::microseconds budget)
+	{
+		assert(type >= 0 && type < pipeline::count);
+		assert(!get_executor(type));
+
+		pipelines[type].set_budget(budget);
+	}
+
+	frame_stats get_frame_stats(const pipeline type)
+	{
+		assert(type >= 0 && type < pipeline::count);
+		return pipelines[type].get_stats();
 	}
 
-	void once(const std::function<void()>& callback, const pipeline type,
-	          const std::chrono::milliseconds delay)
+	void set_profiling(const bool enabled)
 	{
-		schedule([callback]()
+		profiling_enabled = enabled;
+	}
+
+	void print_task_stats()
+	{
+		static const char* pipeline_names[] = {"async", "renderer", "server", "main", "blocking"};
+		static_assert(std::size(pipeline_names) == pipeline::count);
+
+		std::vector<std::pair<pipeline, const task_stats*>> entries{};
+		for (auto i = 0; i < pipeline::count; ++i)
+		{
+			pipelines[i].get_task_stats().for_each([&](const task_stats& stats)
+			{
+				if (stats.executions.load(std::memory_order_relaxed))
+				{
+					entries.emplace_back(static_cast<pipeline>(i), &stats);
+				}
+			});
+		}
+
+		std::ranges::sort(entries, [](const auto& a, const auto& b)
+		{
+			return a.second->total_time.load(std::memory_order_relaxed) > b.second->total_time.load(
+				std::memory_order_relaxed);
+		});
+
+		game::Com_Printf(0, 0, "%-8s %10s %10s %10s %10s %10s  %s\n", "pipeline", "count", "total ms", "max us",
+		                 "p99 us", "late us", "location");
+
+		for (const auto& [type, stats] : entries)
 		{
-			callback();
-			return cond_end;
-		}, type, delay);
+			const auto executions = stats->executions.load(std::memory_order_relaxed);
+			const auto total_time = stats->total_time.load(std::memory_order_relaxed);
+			const auto total_lateness = stats->total_lateness.load(std::memory_order_relaxed);
+
+			game::Com_Printf(0, 0, "%-8s %10llu %10.2f %10.1f %10.1f %10.1f  %s:%u (%s)\n", pipeline_names[type],
+			                 executions, static_cast<double>(total_time) / 1'000'000.0,
+			                 static_cast<double>(stats->max_time.load(std::memory_order_relaxed)) / 1'000.0,
+			                 static_cast<double>(stats->get_p99_time()) / 1'000.0,
+			                 static_cast<double>(total_lateness) / static_cast<double>(executions) / 1'000.0,
+			                 stats->location.file_name(), stats->location.line(),
+			                 stats->location.function_name());
+		}
 	}
 
 	class component final : public component_interface
@@ -152,23 +1191,25 @@ namespace scheduler
 	public:
 		void pre_start() override
 		{
-			thread = utils::thread::create_named_thread("Async Scheduler", []()
+			async_executor.start();
+			blocking_executor.start();
+		}
+
+		void post_unpack() override
+		{
+			command::add("scheduler_profile", []
 			{
-				while (!kill)
-				{
-					execute(pipeline::async);
-					std::this_thread::sleep_for(10ms);
-				}
+				profiling_enabled = !profiling_enabled;
+				game::Com_Printf(0, 0, "Scheduler profiling %s\n", profiling_enabled ? "enabled" : "disabled");
 			});
+
+			command::add("scheduler_stats", print_task_stats);
 		}
 
 		void pre_destroy() override
 		{
-			kill = true;
-			if (thread.joinable())
-			{
-				thread.join();
-			}
+			blocking_executor.stop();
+			async_executor.stop();
 		}
 	};
 }
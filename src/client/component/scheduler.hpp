@@ -1,5 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <coroutine>
+#include <source_location>
+#include <utils/concurrency.hpp>
+#include <utils/unique_function.hpp>
+
 namespace scheduler
 {
 	enum pipeline
@@ -16,18 +26,451 @@ namespace scheduler
 		// The game's main thread
 		main,
 
+		// Asynchronuous pipeline for long-running or blocking tasks (e.g. http requests)
+		blocking,
+
 		count,
 	};
 
+	// Picks what runs first when a frame pipeline is over its budget
+	enum class priority
+	{
+		// Never deferred, runs even if the budget is exhausted
+		critical = 0,
+		high,
+		normal,
+		low,
+	};
+
+	struct frame_stats
+	{
+		uint64_t frames{};
+		uint64_t deferrals{};
+		uint64_t overruns{};
+	};
+
+	// Time source of all pipelines
+	class clock
+	{
+	public:
+		using duration = std::chrono::high_resolution_clock::duration;
+		using time_point = std::chrono::high_resolution_clock::time_point;
+
+		virtual ~clock() = default;
+		virtual time_point now() const = 0;
+	};
+
+	// Only moves when advanced, lets the scheduler be driven deterministically outside the game
+	class virtual_clock final : public clock
+	{
+	public:
+		time_point now() const override;
+		void advance(duration delta);
+
+	private:
+		std::atomic<duration::rep> time_{0};
+	};
+
+	// Replaces the system clock, passing nullptr restores it.
+	// The clock must outlive its use and should be set before anything is scheduled.
+	void set_clock(const clock* clock);
+
+	// Frame driver entry point. The game hooks drive the renderer, server and main pipelines,
+	// anything else (e.g. a simulation) can drive them by calling this once per frame.
+	void run_frame(pipeline type);
+
 	static const bool cond_continue = false;
 	static const bool cond_end = true;
 
-	void schedule(const std::function<bool()>& callback, pipeline type = pipeline::async,
-	              std::chrono::milliseconds delay = 0ms);
-	void loop(const std::function<void()>& callback, pipeline type = pipeline::async,
-	          std::chrono::milliseconds delay = 0ms);
-	void once(const std::function<void()>& callback, pipeline type = pipeline::async,
-	          std::chrono::milliseconds delay = 0ms);
+	// Small captures are stored inline. Once the queues and state pools have grown to their working size,
+	// scheduling doesn't allocate for them.
+	using task_handler = utils::unique_function<bool()>;
+
+	namespace detail
+	{
+		// Shared between a scheduled task, its handles and its dependents
+		class task_state
+		{
+		public:
+			task_state() = default;
+			~task_state();
+
+			task_state(task_state&&) = delete;
+			task_state(const task_state&) = delete;
+			task_state& operator=(task_state&&) = delete;
+			task_state& operator=(const task_state&) = delete;
+
+			bool cancel();
+			void finish();
+			void wait() const;
+
+			bool is_done() const;
+			bool is_finished() const;
+			bool is_cancelled() const;
+
+			// Runs once the task finished or got cancelled, right away if that already happened
+			void on_done(utils::unique_function<void()>&& callback);
+
+		private:
+			enum status : uint8_t
+			{
+				pending = 0,
+				finished,
+				cancelled,
+			};
+
+			struct continuation
+			{
+				utils::unique_function<void()> callback{};
+				continuation* next{};
+			};
+
+			std::atomic<uint8_t> status_{pending};
+			std::atomic<continuation*> continuations_{nullptr};
+
+			void complete();
+			static continuation* get_closed_marker();
+		};
+
+		// The result is published through the status, no additional locking required
+		template <typename T>
+		class result_state : public task_state
+		{
+		public:
+			std::optional<std::conditional_t<std::is_void_v<T>, std::monostate, T>> result{};
+		};
+
+		// Recycles the combined control block and state allocation of std::allocate_shared
+		template <typename T>
+		class state_allocator
+		{
+		public:
+			using value_type = T;
+
+			state_allocator() = default;
+
+			template <typename U>
+			state_allocator(const state_allocator<U>&) noexcept
+			{
+			}
+
+			T* allocate(const size_t count)
+			{
+				if (count != 1)
+				{
+					return std::allocator<T>{}.allocate(count);
+				}
+
+				return static_cast<T*>(get_pool().allocate());
+			}
+
+			void deallocate(T* pointer, const size_t count) noexcept
+			{
+				if (count != 1)
+				{
+					std::allocator<T>{}.deallocate(pointer, count);
+					return;
+				}
+
+				get_pool().free(pointer);
+			}
+
+			template <typename U>
+			bool operator==(const state_allocator<U>&) const noexcept
+			{
+				return true;
+			}
+
+		private:
+			using pool = utils::concurrency::block_pool<sizeof(T), alignof(T)>;
+
+			// Never destroyed, handles may still release states during static destruction
+			static pool& get_pool()
+			{
+				static auto* instance = new pool{};
+				return *instance;
+			}
+		};
+
+		template <typename T>
+		std::shared_ptr<T> make_state()
+		{
+			return std::allocate_shared<T>(state_allocator<T>{});
+		}
+	}
+
+	class task_handle
+	{
+	public:
+		task_handle() = default;
+
+		task_handle(std::shared_ptr<detail::task_state> state)
+			: state_(std::move(state))
+		{
+		}
+
+		// Prevents all further runs of the task and cancels its dependents.
+		// A run that is already in progress completes, but its result is dropped.
+		bool cancel() const
+		{
+			return this->state_ && this->state_->cancel();
+		}
+
+		// Never wait for a task scheduled on the pipeline of the calling thread
+		void wait() const
+		{
+			if (this->state_)
+			{
+				this->state_->wait();
+			}
+		}
+
+		bool is_done() const
+		{
+			return !this->state_ || this->state_->is_done();
+		}
+
+		bool is_cancelled() const
+		{
+			return this->state_ && this->state_->is_cancelled();
+		}
+
+		const std::shared_ptr<detail::task_state>& get_state() const
+		{
+			return this->state_;
+		}
+
+	private:
+		std::shared_ptr<detail::task_state> state_{};
+	};
+
+	template <typename T>
+	class task_future;
+
+	namespace detail
+	{
+		void submit(std::shared_ptr<task_state> state, task_handler&& callback, pipeline type,
+		            std::chrono::milliseconds delay, priority prio, const std::vector<task_handle>& dependencies,
+		            const std::source_location& location);
+	}
+
+	// The source location identifies the task in the profiling stats
+	task_handle schedule(task_handler&& callback, pipeline type = pipeline::async,
+	                     std::chrono::milliseconds delay = 0ms, priority prio = priority::normal,
+	                     const std::source_location& location = std::source_location::current());
+
+	// Same as schedule, but the task can't be waited for, cancelled or depended on.
+	// Skips the shared task state entirely, use it for fire-and-forget work.
+	void schedule_detached(task_handler&& callback, pipeline type = pipeline::async,
+	                       std::chrono::milliseconds delay = 0ms, priority prio = priority::normal,
+	                       const std::source_location& location = std::source_location::current());
+
+	template <typename F>
+	task_handle loop(F&& callback, const pipeline type = pipeline::async,
+	                 const std::chrono::milliseconds delay = 0ms, const priority prio = priority::normal,
+	                 const std::source_location& location = std::source_location::current())
+	{
+		return schedule([callback = std::forward<F>(callback)]() mutable
+		{
+			callback();
+			return cond_continue;
+		}, type, delay, prio, location);
+	}
+
+	template <typename F>
+	task_handle once(F&& callback, const pipeline type = pipeline::async,
+	                 const std::chrono::milliseconds delay = 0ms, const priority prio = priority::normal,
+	                 const std::source_location& location = std::source_location::current())
+	{
+		return schedule([callback = std::forward<F>(callback)]() mutable
+		{
+			callback();
+			return cond_end;
+		}, type, delay, prio, location);
+	}
+
+	// Runs the callback once all dependencies finished, its result is passed on to continuations.
+	// If a dependency gets cancelled, the task is cancelled as well.
+	template <typename F>
+	auto run(F&& callback, const pipeline type = pipeline::async, const std::vector<task_handle>& dependencies = {},
+	         const std::source_location& location = std::source_location::current())
+	{
+		using result_type = std::invoke_result_t<std::decay_t<F>&>;
+
+		auto state = detail::make_state<detail::result_state<result_type>>();
+
+		// The task keeps the state alive while it is scheduled
+		detail::submit(state, [state_ptr = state.get(), callback = std::forward<F>(callback)]() mutable
+		{
+			if constexpr (std::is_void_v<result_type>)
+			{
+				callback();
+				state_ptr->result.emplace();
+			}
+			else
+			{
+				state_ptr->result.emplace(callback());
+			}
+
+			return cond_end;
+		}, type, 0ms, priority::normal, dependencies, location);
+
+		return task_future<result_type>(std::move(state));
+	}
+
+	template <typename T>
+	class task_future : public task_handle
+	{
+	public:
+		task_future() = default;
+
+		task_future(std::shared_ptr<detail::result_state<T>> state)
+			: task_handle(state)
+			  , result_state_(std::move(state))
+		{
+		}
+
+		// Waits for the result, throws if the task got cancelled
+		decltype(auto) get() const
+		{
+			this->wait();
+
+			if (!this->result_state_ || !this->result_state_->is_finished())
+			{
+				throw std::runtime_error("Task was cancelled");
+			}
+
+			if constexpr (!std::is_void_v<T>)
+			{
+				return std::as_const(*this->result_state_->result);
+			}
+		}
+
+		// Runs the continuation with this task's result on the given pipeline.
+		// The result is shared by all continuations, which may run concurrently, so it is passed as const.
+		template <typename F>
+		auto then(F&& continuation, const pipeline type = pipeline::async,
+		          const std::source_location& location = std::source_location::current()) const
+		{
+			return run([state = this->result_state_, continuation = std::forward<F>(continuation)]() mutable
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					return continuation();
+				}
+				else
+				{
+					return continuation(std::as_const(*state->result));
+				}
+			}, type, {*this}, location);
+		}
+
+	private:
+		std::shared_ptr<detail::result_state<T>> result_state_{};
+	};
+
+	// Whether the calling thread is currently running the given pipeline
+	bool is_current_pipeline(pipeline type);
+
+	// Fire-and-forget coroutine type.
+	// The coroutine starts running immediately and frees itself once it completes.
+	struct coroutine
+	{
+		struct promise_type
+		{
+			coroutine get_return_object() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			std::suspend_never final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void() noexcept
+			{
+			}
+
+			void unhandled_exception() noexcept
+			{
+				std::terminate();
+			}
+		};
+	};
+
+	// Resumes the awaiting coroutine from the pipeline's task queue
+	class pipeline_awaitable
+	{
+	public:
+		pipeline_awaitable(const pipeline type, const std::chrono::milliseconds delay, const bool skip_if_current)
+			: type_(type)
+			  , delay_(delay)
+			  , skip_if_current_(skip_if_current)
+		{
+		}
+
+		bool await_ready() const
+		{
+			return this->skip_if_current_ && is_current_pipeline(this->type_);
+		}
+
+		void await_suspend(const std::coroutine_handle<> handle) const
+		{
+			schedule_detached([handle]
+			{
+				handle.resume();
+				return cond_end;
+			}, this->type_, this->delay_);
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+
+	private:
+		pipeline type_{};
+		std::chrono::milliseconds delay_{};
+		bool skip_if_current_{};
+	};
+
+	// co_await scheduler::next_frame(pipeline::main);
+	inline pipeline_awaitable next_frame(const pipeline type)
+	{
+		return {type, 0ms, false};
+	}
+
+	// co_await scheduler::sleep(50ms, pipeline::async);
+	inline pipeline_awaitable sleep(const std::chrono::milliseconds delay, const pipeline type = pipeline::async)
+	{
+		return {type, delay, false};
+	}
+
+	// co_await scheduler::switch_to(pipeline::server);
+	// Continues immediately if the coroutine already runs on that pipeline.
+	inline pipeline_awaitable switch_to(const pipeline type)
+	{
+		return {type, 0ms, true};
+	}
+
+	// Only applies to the async and blocking pipelines.
+	// Throws if called from a task running on the pipeline that is resized.
+	void set_worker_count(pipeline type, size_t count);
+
+	// Only applies to the renderer, server and main pipelines, 0 disables the budget.
+	// Tasks that don't fit into the remaining budget are carried over to the next frame.
+	void set_frame_budget(pipeline type, std::chrono::microseconds budget);
+	frame_stats get_frame_stats(pipeline type);
+
+	// Records per-task runtime and lateness, dumped through the scheduler_stats command
+	void set_profiling(bool enabled);
+	void print_task_stats();
+
 	void on_game_initialized(const std::function<void()>& callback, pipeline type = pipeline::async,
 	                         std::chrono::milliseconds delay = 0ms);
 }
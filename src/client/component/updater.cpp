@@ -30,8 +30,8 @@ namespace updater
 		std::string get_version()
 		{
 			const auto zip = get_version_zip();
-			auto res = utils::compression::zip::extract(zip);
-			return res["version.txt"];
+			const utils::compression::zip::reader reader{zip};
+			return reader.read("version.txt").value_or(std::string{});
 		}
 
 		bool requires_update()
@@ -70,12 +70,13 @@ namespace updater
 
 		std::string get_binary(const std::string& data)
 		{
-			auto res = utils::compression::zip::extract(data);
-			if (res.size() == 1)
+			const utils::compression::zip::reader reader{data};
+			if (reader.size() == 1)
 			{
-				for (auto& file : res)
+				auto binary = reader.read(reader.get_entries().front());
+				if (binary)
 				{
-					return std::move(file.second);
+					return std::move(*binary);
 				}
 			}
 
@@ -1,8 +1,25 @@
 #include <std_include.hpp>
 #include "../steam.hpp"
 
+#include <utils/info_string.hpp>
+
 namespace steam
 {
+	namespace
+	{
+		struct server_state
+		{
+			utils::info_string key_values{};
+			utils::info_string game_tags{};
+		};
+
+		utils::concurrency::container<server_state>& get_server_state()
+		{
+			static utils::concurrency::container<server_state> state{"steam::game_server"};
+			return state;
+		}
+	}
+
 	bool game_server::InitGameServer(unsigned int unGameIP, unsigned short unGamePort, unsigned short usQueryPort,
 	                                 unsigned int unServerFlags, unsigned int nAppID, const char* pchVersion)
 	{
@@ -90,14 +107,33 @@ namespace steam
 
 	void game_server::ClearAllKeyValues()
 	{
+		get_server_state().access([](server_state& state)
+		{
+			state.key_values.clear();
+		});
 	}
 
 	void game_server::SetKeyValue(const char* pKey, const char* pValue)
 	{
+		if (!pKey)
+		{
+			return;
+		}
+
+		get_server_state().access([&](server_state& state)
+		{
+			state.key_values.set(pKey, pValue ? pValue : "");
+		});
 	}
 
 	void game_server::SetGameTags(const char* pchGameTags)
 	{
+		const utils::info_string game_tags{std::string_view{pchGameTags ? pchGameTags : ""}};
+
+		get_server_state().access([&](server_state& state)
+		{
+			state.game_tags.assign(game_tags);
+		});
 	}
 
 	void game_server::SetGameData(const char* pchGameData)
@@ -201,4 +237,18 @@ namespace steam
 	{
 		return 0;
 	}
+
+	bool game_server::get_game_tags(std::string& output)
+	{
+		return get_server_state().access<bool>([&](const server_state& state)
+		{
+			if (state.game_tags.empty())
+			{
+				return false;
+			}
+
+			state.game_tags.build(output);
+			return true;
+		});
+	}
 }
@@ -53,5 +53,8 @@ namespace steam
 		virtual void ForceHeartbeat();
 		virtual unsigned long long AssociateWithClan(steam_id clanID);
 		virtual unsigned long long ComputeNewPlayerCompatibility(steam_id steamID);
+
+		// Builds the current game tags into the output, leaves it untouched if none were set
+		static bool get_game_tags(std::string& output);
 	};
 }
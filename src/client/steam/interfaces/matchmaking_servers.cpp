@@ -5,6 +5,19 @@ namespace steam
 {
 	namespace
 	{
+		// The local server's tags are built straight from its state, defaults until the game sets them
+		void update_game_tags(gameserveritem_t& server)
+		{
+			std::string game_tags{};
+			if (!game_server::get_game_tags(game_tags))
+			{
+				game_tags =
+					R"(\gametype\gun\dedicated\true\ranked\true\hardcore\false\zombies\false\modName\usermaps\playerCount\0)";
+			}
+
+			strncpy_s(server.m_szGameTags, game_tags.data(), _TRUNCATE);
+		}
+
 		gameserveritem_t* get_server_item()
 		{
 			static gameserveritem_t server{};
@@ -26,8 +39,7 @@ namespace steam
 			server.m_ulTimeLastPlayed = 0;
 			server.m_nServerVersion = 1000;
 			strcpy_s(server.m_szServerName, "BO^3I^5I^6I ^7Server");
-			strcpy_s(server.m_szGameTags,
-			         R"(\gametype\gun\dedicated\true\ranked\true\hardcore\false\zombies\false\modName\usermaps\playerCount\0)");
+			update_game_tags(server);
 			server.m_steamID = steam_id();
 
 			return &server;
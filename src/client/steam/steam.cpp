@@ -9,7 +9,7 @@
 namespace steam
 {
 	uint64_t callbacks::call_id_ = 0;
-	std::recursive_mutex callbacks::mutex_;
+	utils::concurrency::recursive_mutex callbacks::mutex_;
 	std::map<uint64_t, bool> callbacks::calls_;
 	std::map<uint64_t, callbacks::base*> callbacks::result_handlers_;
 	std::vector<callbacks::result> callbacks::results_;
@@ -17,21 +17,21 @@ namespace steam
 
 	uint64_t callbacks::register_call()
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 		calls_[++call_id_] = false;
 		return call_id_;
 	}
 
 	void callbacks::register_callback(base* handler, const int callback)
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 		handler->set_i_callback(callback);
 		callback_list_.push_back(handler);
 	}
 
 	void callbacks::unregister_callback(base* handler)
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 		for (auto i = callback_list_.begin(); i != callback_list_.end();)
 		{
 			if (*i == handler)
@@ -47,13 +47,13 @@ namespace steam
 
 	void callbacks::register_call_result(const uint64_t call, base* result)
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 		result_handlers_[call] = result;
 	}
 
 	void callbacks::unregister_call_result(const uint64_t call, base* /*result*/)
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 		const auto i = result_handlers_.find(call);
 		if (i != result_handlers_.end())
 		{
@@ -63,7 +63,7 @@ namespace steam
 
 	void callbacks::return_call(void* data, const int size, const int type, const uint64_t call)
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 
 		result result{};
 		result.call = call;
@@ -78,7 +78,7 @@ namespace steam
 
 	void callbacks::run_callbacks()
 	{
-		std::lock_guard<std::recursive_mutex> _(mutex_);
+		std::lock_guard _(mutex_);
 
 		for (const auto& result : results_)
 		{
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <utils/concurrency.hpp>
+
 //#define STEAM_EXPORT extern "C" __declspec(dllexport)
 #define STEAM_EXPORT
 
@@ -96,7 +98,7 @@ namespace steam
 
 	private:
 		static uint64_t call_id_;
-		static std::recursive_mutex mutex_;
+		static utils::concurrency::recursive_mutex mutex_;
 		static std::map<uint64_t, bool> calls_;
 		static std::map<uint64_t, base*> result_handlers_;
 		static std::vector<result> results_;
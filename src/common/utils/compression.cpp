@@ -3,143 +3,1205 @@
 
 #include <zlib.h>
 #include <zip.h>
-#include <unzip.h>
+#include <lz4.h>
 
 #include "io.hpp"
 #include "finally.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+
 namespace utils::compression
 {
 	namespace zlib
 	{
 		namespace
 		{
-			class zlib_stream
+			// avail_in and avail_out are 32 bit, larger buffers are handed over in slices
+			constexpr size_t max_slice = 1u << 30;
+
+			int get_zlib_strategy(const strategy strategy)
 			{
-			public:
-				zlib_stream()
+				switch (strategy)
 				{
-					memset(&stream_, 0, sizeof(stream_));
-					valid_ = inflateInit(&stream_) == Z_OK;
+				case strategy::filtered:
+					return Z_FILTERED;
+				case strategy::huffman_only:
+					return Z_HUFFMAN_ONLY;
+				case strategy::rle:
+					return Z_RLE;
+				case strategy::fixed:
+					return Z_FIXED;
+				default:
+					return Z_DEFAULT_STRATEGY;
 				}
+			}
+
+			int get_window_bits(const format format)
+			{
+				return format == format::raw ? -MAX_WBITS : MAX_WBITS;
+			}
+
+			uInt get_slice(const size_t length)
+			{
+				return static_cast<uInt>(std::min(length, max_slice));
+			}
+
+			enum class one_shot_result
+			{
+				success,
+				no_space,
+				error,
+			};
 
-				zlib_stream(zlib_stream&&) = delete;
-				zlib_stream(const zlib_stream&) = delete;
-				zlib_stream& operator=(zlib_stream&&) = delete;
-				zlib_stream& operator=(const zlib_stream&) = delete;
+			// Runs a whole buffer through deflate or inflate into a fixed output buffer
+			template <typename Function>
+			one_shot_result run_one_shot(z_stream& stream, const std::string_view input, void* output,
+			                             const size_t capacity, const Function& function, size_t& length)
+			{
+				auto* out = static_cast<Bytef*>(output);
+				size_t in_offset = 0;
+				size_t out_offset = 0;
+
+				// zlib rejects null buffers even when they are empty
+				stream.next_in = reinterpret_cast<const Bytef*>(input.data());
+				stream.avail_in = 0;
+				stream.next_out = out;
+				stream.avail_out = 0;
 
-				~zlib_stream()
+				while (true)
 				{
-					if (valid_)
+					if (!stream.avail_in && in_offset < input.size())
+					{
+						stream.next_in = reinterpret_cast<const Bytef*>(input.data()) + in_offset;
+						stream.avail_in = get_slice(input.size() - in_offset);
+						in_offset += stream.avail_in;
+					}
+
+					if (!stream.avail_out && out_offset < capacity)
+					{
+						stream.next_out = out + out_offset;
+						stream.avail_out = get_slice(capacity - out_offset);
+						out_offset += stream.avail_out;
+					}
+
+					const auto result = function(&stream, in_offset == input.size() ? Z_FINISH : Z_NO_FLUSH);
+					if (result == Z_STREAM_END)
+					{
+						length = out_offset - stream.avail_out;
+						return one_shot_result::success;
+					}
+
+					if (result == Z_OK)
+					{
+						continue;
+					}
+
+					// No progress possible, either the output is full or the input is truncated
+					if (result == Z_BUF_ERROR && !stream.avail_out)
 					{
-						inflateEnd(&stream_);
+						if (out_offset == capacity)
+						{
+							return one_shot_result::no_space;
+						}
+
+						continue;
 					}
+
+					return one_shot_result::error;
 				}
+			}
+
+			// Shared per thread, so callers must not hold on to them across calls that might use them too
+			deflate_stream& get_raw_deflate_stream(const int level)
+			{
+				static thread_local deflate_stream stream{best_compression, strategy::standard, format::raw};
+
+				stream.set_params(level, strategy::standard);
+				return stream;
+			}
+
+			inflate_stream& get_raw_inflate_stream()
+			{
+				static thread_local inflate_stream stream{format::raw};
+				return stream;
+			}
+
+			inflate_stream& get_inflate_stream()
+			{
+				static thread_local inflate_stream stream{};
+				return stream;
+			}
+		}
 
-				z_stream& get()
+		struct deflate_stream::state
+		{
+			~state()
+			{
+				if (this->valid)
 				{
-					return stream_; //
+					deflateEnd(&this->stream);
 				}
+			}
+
+			z_stream stream{};
+			bool valid{};
+			uint8_t buffer[CHUNK]{};
+		};
+
+		deflate_stream::deflate_stream(const int level, const strategy strategy, const format format)
+			: state_(std::make_unique<state>())
+		{
+			this->state_->valid = deflateInit2(&this->state_->stream, level, Z_DEFLATED, get_window_bits(format), 8,
+			                                   get_zlib_strategy(strategy)) == Z_OK;
+		}
+
+		deflate_stream::~deflate_stream() = default;
+		deflate_stream::deflate_stream(deflate_stream&& obj) noexcept = default;
+		deflate_stream& deflate_stream::operator=(deflate_stream&& obj) noexcept = default;
+
+		bool deflate_stream::is_valid() const
+		{
+			return this->state_ && this->state_->valid;
+		}
+
+		bool deflate_stream::set_params(const int level, const strategy strategy)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			this->reset();
+			return deflateParams(&this->state_->stream, level, get_zlib_strategy(strategy)) == Z_OK;
+		}
+
+		void deflate_stream::reset()
+		{
+			if (this->is_valid())
+			{
+				deflateReset(&this->state_->stream);
+			}
+		}
+
+		bool deflate_stream::set_dictionary(const std::string_view dictionary)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			// Only the last window's worth can ever be referenced
+			const auto length = std::min(dictionary.size(), size_t{1} << MAX_WBITS);
+			const auto* data = reinterpret_cast<const Bytef*>(dictionary.data()) + dictionary.size() - length;
+
+			return deflateSetDictionary(&this->state_->stream, data, static_cast<uInt>(length)) == Z_OK;
+		}
+
+		size_t deflate_stream::get_bound(const size_t length)
+		{
+			if (!this->is_valid() || length > std::numeric_limits<uLong>::max())
+			{
+				// Worst case of stored blocks plus header and trailer
+				return length + ((length + 7) >> 3) + ((length + 63) >> 6) + 5 + 18;
+			}
+
+			return deflateBound(&this->state_->stream, static_cast<uLong>(length));
+		}
+
+		bool deflate_stream::write(const std::string_view input, const sink& output)
+		{
+			return this->run(input, Z_NO_FLUSH, output);
+		}
+
+		bool deflate_stream::flush(const sink& output)
+		{
+			return this->run({}, Z_SYNC_FLUSH, output);
+		}
+
+		bool deflate_stream::finish(const sink& output)
+		{
+			const auto result = this->run({}, Z_FINISH, output);
+			this->reset();
+			return result;
+		}
+
+		bool deflate_stream::run(const std::string_view input, const int flush, const sink& output)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			auto& stream = this->state_->stream;
+			auto* buffer = this->state_->buffer;
+			size_t offset = 0;
+
+			do
+			{
+				const auto slice = get_slice(input.size() - offset);
+				stream.next_in = reinterpret_cast<const Bytef*>(input.data()) + offset;
+				stream.avail_in = slice;
+				offset += slice;
+
+				const auto slice_flush = offset == input.size() ? flush : Z_NO_FLUSH;
 
-				bool is_valid() const
+				do
 				{
-					return valid_;
+					stream.next_out = buffer;
+					stream.avail_out = CHUNK;
+
+					if (deflate(&stream, slice_flush) == Z_STREAM_ERROR)
+					{
+						return false;
+					}
+
+					const auto produced = CHUNK - stream.avail_out;
+					if (produced && !output(buffer, produced))
+					{
+						return false;
+					}
 				}
+				while (stream.avail_out == 0);
+			}
+			while (offset < input.size());
 
-			private:
-				bool valid_{false};
-				z_stream stream_{};
-			};
+			return true;
 		}
 
-		std::string decompress(const std::string& data)
+		bool deflate_stream::compress(const std::string_view input, std::string& output)
 		{
-			std::string buffer{};
-			zlib_stream stream_container{};
-			if (!stream_container.is_valid())
+			output.resize(this->get_bound(input.size()));
+
+			const auto length = this->compress(input, output.data(), output.size());
+			if (!length)
+			{
+				output.clear();
+				return false;
+			}
+
+			output.resize(*length);
+			return true;
+		}
+
+		std::optional<size_t> deflate_stream::compress(const std::string_view input, void* output,
+		                                               const size_t capacity)
+		{
+			if (!this->is_valid())
+			{
+				return {};
+			}
+
+			this->reset();
+			const auto _ = finally([this]
+			{
+				this->reset();
+			});
+
+			size_t length{};
+			const auto result = run_one_shot(this->state_->stream, input, output, capacity, deflate, length);
+			if (result != one_shot_result::success)
 			{
 				return {};
 			}
 
-			int ret{};
+			return length;
+		}
+
+		struct inflate_stream::state
+		{
+			~state()
+			{
+				if (this->valid)
+				{
+					inflateEnd(&this->stream);
+				}
+			}
+
+			z_stream stream{};
+			bool valid{};
+			bool finished{};
+			uint8_t buffer[CHUNK]{};
+		};
+
+		inflate_stream::inflate_stream(const format format)
+			: state_(std::make_unique<state>())
+		{
+			this->state_->valid = inflateInit2(&this->state_->stream, get_window_bits(format)) == Z_OK;
+		}
+
+		inflate_stream::~inflate_stream() = default;
+		inflate_stream::inflate_stream(inflate_stream&& obj) noexcept = default;
+		inflate_stream& inflate_stream::operator=(inflate_stream&& obj) noexcept = default;
+
+		bool inflate_stream::is_valid() const
+		{
+			return this->state_ && this->state_->valid;
+		}
+
+		bool inflate_stream::set_dictionary(const std::string_view dictionary)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			const auto length = std::min(dictionary.size(), size_t{1} << MAX_WBITS);
+			const auto* data = reinterpret_cast<const Bytef*>(dictionary.data()) + dictionary.size() - length;
+
+			return inflateSetDictionary(&this->state_->stream, data, static_cast<uInt>(length)) == Z_OK;
+		}
+
+		bool inflate_stream::is_finished() const
+		{
+			return this->state_ && this->state_->finished;
+		}
+
+		void inflate_stream::reset()
+		{
+			if (this->is_valid())
+			{
+				inflateReset(&this->state_->stream);
+				this->state_->finished = false;
+			}
+		}
+
+		bool inflate_stream::write(const std::string_view input, const sink& output)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			if (this->state_->finished)
+			{
+				return true;
+			}
+
+			auto& stream = this->state_->stream;
+			auto* buffer = this->state_->buffer;
 			size_t offset = 0;
-			static thread_local uint8_t dest[CHUNK] = {0};
-			auto& stream = stream_container.get();
 
 			do
 			{
-				const auto input_size = std::min(sizeof(dest), data.size() - offset);
-				stream.avail_in = static_cast<uInt>(input_size);
-				stream.next_in = reinterpret_cast<const Bytef*>(data.data()) + offset;
-				offset += stream.avail_in;
+				const auto slice = get_slice(input.size() - offset);
+				stream.next_in = reinterpret_cast<const Bytef*>(input.data()) + offset;
+				stream.avail_in = slice;
+				offset += slice;
 
 				do
 				{
-					stream.avail_out = sizeof(dest);
-					stream.next_out = dest;
+					stream.next_out = buffer;
+					stream.avail_out = CHUNK;
+
+					const auto result = inflate(&stream, Z_NO_FLUSH);
+					if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+					{
+						return false;
+					}
 
-					ret = inflate(&stream, Z_NO_FLUSH);
-					if (ret != Z_OK && ret != Z_STREAM_END)
+					const auto produced = CHUNK - stream.avail_out;
+					if (produced && !output(buffer, produced))
 					{
-						return {};
+						return false;
 					}
 
-					buffer.insert(buffer.end(), dest, dest + sizeof(dest) - stream.avail_out);
+					if (result == Z_STREAM_END)
+					{
+						this->state_->finished = true;
+						return true;
+					}
 				}
 				while (stream.avail_out == 0);
 			}
-			while (ret != Z_STREAM_END);
+			while (offset < input.size());
+
+			return true;
+		}
+
+		bool inflate_stream::decompress(const std::string_view input, std::string& output, const size_t size_hint)
+		{
+			if (!this->is_valid())
+			{
+				return false;
+			}
+
+			output.resize(size_hint ? size_hint : std::max<size_t>(input.size() * 4, CHUNK));
+
+			while (true)
+			{
+				this->reset();
+
+				size_t length{};
+				const auto result = run_one_shot(this->state_->stream, input, output.data(), output.size(), inflate,
+				                                 length);
+
+				if (result == one_shot_result::success)
+				{
+					this->state_->finished = true;
+					output.resize(length);
+					return true;
+				}
+
+				if (result == one_shot_result::error)
+				{
+					output.clear();
+					return false;
+				}
+
+				output.resize(output.size() * 2);
+			}
+		}
+
+		std::optional<size_t> inflate_stream::decompress(const std::string_view input, void* output,
+		                                                 const size_t capacity)
+		{
+			if (!this->is_valid())
+			{
+				return {};
+			}
+
+			this->reset();
+
+			size_t length{};
+			const auto result = run_one_shot(this->state_->stream, input, output, capacity, inflate, length);
+			if (result != one_shot_result::success)
+			{
+				return {};
+			}
+
+			this->state_->finished = true;
+			return length;
+		}
+
+		std::string decompress(const std::string& data, const size_t size_hint)
+		{
+			std::string buffer{};
+			if (!get_inflate_stream().decompress(data, buffer, size_hint))
+			{
+				return {};
+			}
+
+			return buffer;
+		}
+
+		std::string compress(const std::string& data, const int level)
+		{
+			static thread_local deflate_stream stream{};
+
+			std::string buffer{};
+			if (!stream.set_params(level, strategy::standard) || !stream.compress(data, buffer))
+			{
+				return {};
+			}
+
+			return buffer;
+		}
+	}
+
+	namespace lz4
+	{
+		namespace
+		{
+			int get_capacity(const size_t capacity)
+			{
+				return static_cast<int>(std::min(capacity, static_cast<size_t>(std::numeric_limits<int>::max())));
+			}
+		}
+
+		size_t get_bound(const size_t length)
+		{
+			if (length > LZ4_MAX_INPUT_SIZE)
+			{
+				return 0;
+			}
+
+			return static_cast<size_t>(LZ4_compressBound(static_cast<int>(length)));
+		}
+
+		std::optional<size_t> compress(const std::string_view input, void* output, const size_t capacity)
+		{
+			if (input.size() > LZ4_MAX_INPUT_SIZE)
+			{
+				return {};
+			}
+
+			const auto length = LZ4_compress_default(input.data(), static_cast<char*>(output),
+			                                         static_cast<int>(input.size()), get_capacity(capacity));
+			if (length <= 0)
+			{
+				return {};
+			}
+
+			return static_cast<size_t>(length);
+		}
+
+		std::optional<size_t> decompress(const std::string_view input, void* output, const size_t capacity)
+		{
+			if (input.empty() || input.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+			{
+				return {};
+			}
+
+			const auto length = LZ4_decompress_safe(input.data(), static_cast<char*>(output),
+			                                        static_cast<int>(input.size()), get_capacity(capacity));
+			if (length < 0)
+			{
+				return {};
+			}
+
+			return static_cast<size_t>(length);
+		}
+	}
+
+	namespace
+	{
+		constexpr uint8_t frame_magic = 0xB3;
+		constexpr uint8_t frame_flag_dictionary = 0x80;
+		constexpr size_t max_frame_header_size = 2 + 10 + 5;
+
+		// Deflate can't expand data by more than this, larger sizes are bogus
+		constexpr uint64_t max_frame_ratio = 1032;
+
+		class none_codec final : public codec
+		{
+		public:
+			codec_type get_type() const override
+			{
+				return codec_type::none;
+			}
+
+			size_t get_bound(const size_t length) const override
+			{
+				return length;
+			}
+
+			std::optional<size_t> compress(const std::string_view input, void* output, const size_t capacity,
+			                               int /*level*/) const override
+			{
+				return this->decompress(input, output, capacity);
+			}
+
+			std::optional<size_t> decompress(const std::string_view input, void* output,
+			                                 const size_t capacity) const override
+			{
+				if (input.size() > capacity)
+				{
+					return {};
+				}
+
+				std::copy(input.begin(), input.end(), static_cast<char*>(output));
+				return input.size();
+			}
+		};
+
+		// Raw deflate, the frame already carries the size
+		class zlib_codec final : public codec
+		{
+		public:
+			codec_type get_type() const override
+			{
+				return codec_type::zlib;
+			}
+
+			size_t get_bound(const size_t length) const override
+			{
+				return zlib::get_raw_deflate_stream(zlib::default_compression).get_bound(length);
+			}
+
+			std::optional<size_t> compress(const std::string_view input, void* output, const size_t capacity,
+			                               const int level) const override
+			{
+				return zlib::get_raw_deflate_stream(level).compress(input, output, capacity);
+			}
+
+			std::optional<size_t> decompress(const std::string_view input, void* output,
+			                                 const size_t capacity) const override
+			{
+				return zlib::get_raw_inflate_stream().decompress(input, output, capacity);
+			}
+		};
+
+		class lz4_codec final : public codec
+		{
+		public:
+			codec_type get_type() const override
+			{
+				return codec_type::lz4;
+			}
+
+			size_t get_bound(const size_t length) const override
+			{
+				return lz4::get_bound(length);
+			}
+
+			std::optional<size_t> compress(const std::string_view input, void* output, const size_t capacity,
+			                               int /*level*/) const override
+			{
+				return lz4::compress(input, output, capacity);
+			}
+
+			std::optional<size_t> decompress(const std::string_view input, void* output,
+			                                 const size_t capacity) const override
+			{
+				return lz4::decompress(input, output, capacity);
+			}
+		};
+
+		struct frame_header
+		{
+			codec_type type{};
+			uint64_t size{};
+			std::optional<uint32_t> dictionary_id{};
+		};
+
+		size_t write_varint(char* output, uint64_t value)
+		{
+			size_t length = 0;
+
+			do
+			{
+				const auto part = static_cast<uint8_t>(value & 0x7F);
+				value >>= 7;
+				output[length++] = static_cast<char>(part | (value ? 0x80 : 0));
+			}
+			while (value);
+
+			return length;
+		}
+
+		bool read_varint(std::string_view& data, uint64_t& value)
+		{
+			value = 0;
+
+			for (size_t i = 0, shift = 0; i < data.size() && shift < 64; ++i, shift += 7)
+			{
+				const auto part = static_cast<uint8_t>(data[i]);
+				value |= static_cast<uint64_t>(part & 0x7F) << shift;
+
+				if (!(part & 0x80))
+				{
+					data.remove_prefix(i + 1);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		size_t write_frame_header(char* output, const frame_header& header)
+		{
+			size_t length = 0;
+			output[length++] = static_cast<char>(frame_magic);
+			output[length++] = static_cast<char>(static_cast<uint8_t>(header.type)
+				| (header.dictionary_id ? frame_flag_dictionary : 0));
+
+			length += write_varint(output + length, header.size);
+
+			if (header.dictionary_id)
+			{
+				length += write_varint(output + length, *header.dictionary_id);
+			}
+
+			return length;
+		}
+
+		bool read_frame_header(std::string_view& data, frame_header& header)
+		{
+			if (data.size() < 3 || static_cast<uint8_t>(data[0]) != frame_magic)
+			{
+				return false;
+			}
+
+			const auto type = static_cast<uint8_t>(data[1]);
+			header.type = static_cast<codec_type>(type & ~frame_flag_dictionary);
+			header.dictionary_id = {};
+
+			auto frame = data.substr(2);
+			if (!read_varint(frame, header.size))
+			{
+				return false;
+			}
+
+			if (type & frame_flag_dictionary)
+			{
+				uint64_t id{};
+				if (!read_varint(frame, id) || id > std::numeric_limits<uint32_t>::max())
+				{
+					return false;
+				}
+
+				header.dictionary_id = static_cast<uint32_t>(id);
+			}
+
+			data = frame;
+			return true;
+		}
+	}
+
+	const codec* get_codec(const codec_type type)
+	{
+		static const none_codec none{};
+		static const zlib_codec zlib{};
+		static const lz4_codec lz4{};
+
+		switch (type)
+		{
+		case codec_type::none:
+			return &none;
+		case codec_type::zlib:
+			return &zlib;
+		case codec_type::lz4:
+			return &lz4;
+		default:
+			return nullptr;
+		}
+	}
+
+	std::string compress(const std::string_view data, const codec_type type, const int level)
+	{
+		const auto* codec = get_codec(type);
+		if (!codec)
+		{
+			return {};
+		}
+
+		std::string output{};
+		output.resize(max_frame_header_size + std::max(codec->get_bound(data.size()), data.size()));
+
+		auto header_size = write_frame_header(output.data(), {type, data.size()});
+		auto length = codec->compress(data, output.data() + header_size, output.size() - header_size, level);
+
+		if (!length || *length >= data.size())
+		{
+			header_size = write_frame_header(output.data(), {codec_type::none, data.size()});
+			length = get_codec(codec_type::none)->compress(data, output.data() + header_size,
+			                                                output.size() - header_size, level);
+		}
+
+		output.resize(header_size + *length);
+		return output;
+	}
+
+	std::optional<std::string> decompress(std::string_view data)
+	{
+		frame_header header{};
+		if (!read_frame_header(data, header))
+		{
+			std::string output{};
+			if (!zlib::get_inflate_stream().decompress(data, output))
+			{
+				return {};
+			}
+
+			return output;
+		}
+
+		// Dictionary frames can only be read through a dictionary_compressor
+		const auto* codec = get_codec(header.type);
+		if (!codec || header.dictionary_id || header.size / max_frame_ratio > data.size())
+		{
+			return {};
+		}
+
+		std::string output{};
+		output.resize(header.size);
+
+		const auto length = codec->decompress(data, output.data(), output.size());
+		if (!length || *length != header.size)
+		{
+			return {};
+		}
+
+		return output;
+	}
+
+	std::optional<uint32_t> get_dictionary_id(std::string_view data)
+	{
+		frame_header header{};
+		if (!read_frame_header(data, header))
+		{
+			return {};
+		}
+
+		return header.dictionary_id;
+	}
+
+	dictionary train_dictionary(const uint32_t id, const std::vector<std::string>& samples, const size_t size)
+	{
+		constexpr size_t gram_size = 8;
+		constexpr size_t segment_size = 32;
+
+		// Counts how many samples contain each gram, grams unique to one sample don't help
+		std::unordered_map<std::string_view, uint32_t> frequencies{};
+		for (const auto& sample : samples)
+		{
+			std::unordered_set<std::string_view> seen{};
+			for (size_t i = 0; i + gram_size <= sample.size(); ++i)
+			{
+				const auto gram = std::string_view(sample).substr(i, gram_size);
+				if (seen.insert(gram).second)
+				{
+					++frequencies[gram];
+				}
+			}
+		}
+
+		const auto get_score = [&frequencies](const std::string_view segment)
+		{
+			uint64_t score = 0;
+			for (size_t i = 0; i + gram_size <= segment.size(); ++i)
+			{
+				const auto frequency = frequencies.find(segment.substr(i, gram_size));
+				if (frequency != frequencies.end() && frequency->second > 1)
+				{
+					score += frequency->second;
+				}
+			}
+
+			return score;
+		};
+
+		struct candidate
+		{
+			uint64_t score{};
+			std::string_view segment{};
+
+			bool operator<(const candidate& obj) const
+			{
+				return this->score < obj.score;
+			}
+		};
+
+		std::priority_queue<candidate> candidates{};
+		for (const auto& sample : samples)
+		{
+			for (size_t offset = 0; offset + gram_size <= sample.size(); offset += segment_size / 2)
+			{
+				const auto segment = std::string_view(sample).substr(offset, segment_size);
+				const auto score = get_score(segment);
+				if (score)
+				{
+					candidates.push({score, segment});
+				}
+			}
+		}
+
+		std::vector<std::string_view> selected{};
+		size_t total_size = 0;
+
+		while (!candidates.empty() && total_size < size)
+		{
+			auto candidate = candidates.top();
+			candidates.pop();
+
+			// Grams covered by earlier picks don't count anymore, so scores are refreshed lazily
+			const auto score = get_score(candidate.segment);
+			if (!score)
+			{
+				continue;
+			}
+
+			if (score < candidate.score && !candidates.empty() && score < candidates.top().score)
+			{
+				candidate.score = score;
+				candidates.push(candidate);
+				continue;
+			}
+
+			selected.push_back(candidate.segment);
+			total_size += candidate.segment.size();
+
+			for (size_t i = 0; i + gram_size <= candidate.segment.size(); ++i)
+			{
+				frequencies[candidate.segment.substr(i, gram_size)] = 0;
+			}
+		}
+
+		dictionary dictionary{id};
+		dictionary.data.reserve(total_size);
+
+		// Closer matches are cheaper to encode, so the most valuable segments go last
+		for (auto segment = selected.rbegin(); segment != selected.rend(); ++segment)
+		{
+			dictionary.data.append(*segment);
+		}
+
+		if (dictionary.data.size() > size)
+		{
+			dictionary.data.erase(0, dictionary.data.size() - size);
+		}
+
+		return dictionary;
+	}
+
+	dictionary_compressor::dictionary_compressor(dictionary dictionary, const int level)
+		: dictionary_(std::move(dictionary))
+		  , deflate_(level, zlib::strategy::standard, zlib::format::raw)
+		  , inflate_(zlib::format::raw)
+	{
+	}
+
+	const dictionary& dictionary_compressor::get_dictionary() const
+	{
+		return this->dictionary_;
+	}
+
+	std::string dictionary_compressor::compress(const std::string_view data)
+	{
+		std::string output{};
+		output.resize(max_frame_header_size);
+		output.resize(write_frame_header(output.data(), {codec_type::zlib, data.size(), this->dictionary_.id}));
+
+		const auto header_size = output.size();
+		const zlib::sink sink = [&output](const uint8_t* chunk, const size_t length)
+		{
+			output.append(reinterpret_cast<const char*>(chunk), length);
+			return true;
+		};
+
+		this->deflate_.reset();
+
+		const auto success = this->deflate_.set_dictionary(this->dictionary_.data)
+			&& this->deflate_.write(data, sink)
+			&& this->deflate_.finish(sink);
+
+		if (!success || output.size() - header_size >= data.size())
+		{
+			return compression::compress(data, codec_type::none);
+		}
+
+		return output;
+	}
+
+	std::optional<std::string> dictionary_compressor::decompress(const std::string_view data)
+	{
+		auto frame = data;
+		frame_header header{};
+
+		if (!read_frame_header(frame, header) || !header.dictionary_id)
+		{
+			return compression::decompress(data);
+		}
+
+		if (*header.dictionary_id != this->dictionary_.id || header.type != codec_type::zlib
+			|| header.size / max_frame_ratio > frame.size())
+		{
+			return {};
+		}
+
+		std::string output{};
+		output.reserve(header.size);
+
+		const zlib::sink sink = [&output, &header](const uint8_t* chunk, const size_t length)
+		{
+			if (length > header.size - output.size())
+			{
+				return false;
+			}
+
+			output.append(reinterpret_cast<const char*>(chunk), length);
+			return true;
+		};
+
+		this->inflate_.reset();
+
+		if (!this->inflate_.set_dictionary(this->dictionary_.data) || !this->inflate_.write(frame, sink)
+			|| !this->inflate_.is_finished() || output.size() != header.size)
+		{
+			return {};
+		}
+
+		return output;
+	}
+
+	namespace zip
+	{
+		namespace
+		{
+			// Entries above this are split into blocks when deflating in parallel
+			constexpr size_t parallel_block_size = 1u << 20;
+
+			// Blocks are primed with the end of the previous one, so the split barely costs any ratio
+			constexpr size_t block_dictionary_size = 1u << 15;
+
+			struct deflate_job
+			{
+				std::string_view input{};
+				std::string_view dictionary{};
+				bool last{};
+
+				std::string output{};
+				uint32_t crc{};
+				bool success{};
+			};
+
+			size_t get_thread_count(const size_t thread_count, const size_t job_count)
+			{
+				const size_t threads = thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+				return std::max<size_t>(1, std::min(threads, job_count));
+			}
+
+			// The calling thread takes part as well, so a single thread never spawns anything
+			template <typename Job>
+			void run_jobs(const size_t job_count, const size_t thread_count, const Job& job)
+			{
+				std::atomic_size_t next_job{0};
+				const auto worker = [&]
+				{
+					for (auto i = next_job++; i < job_count; i = next_job++)
+					{
+						job(i);
+					}
+				};
+
+				std::vector<std::thread> threads{};
+				for (size_t i = 1; i < get_thread_count(thread_count, job_count); ++i)
+				{
+					threads.emplace_back(worker);
+				}
+
+				worker();
+
+				for (auto& thread : threads)
+				{
+					thread.join();
+				}
+			}
+
+			uint32_t update_crc(uint32_t crc, const void* data, const size_t length)
+			{
+				const auto* bytes = static_cast<const Bytef*>(data);
+				for (size_t offset = 0; offset < length;)
+				{
+					const auto slice = zlib::get_slice(length - offset);
+					crc = crc32(crc, bytes + offset, slice);
+					offset += slice;
+				}
+
+				return crc;
+			}
+
+			void run_deflate_job(deflate_job& job, const int level)
+			{
+				auto& stream = zlib::get_raw_deflate_stream(level);
+
+				const zlib::sink output = [&job](const uint8_t* data, const size_t length)
+				{
+					job.output.append(reinterpret_cast<const char*>(data), length);
+					return true;
+				};
+
+				job.crc = update_crc(0, job.input.data(), job.input.size());
+				job.success = (job.dictionary.empty() || stream.set_dictionary(job.dictionary))
+					&& stream.write(job.input, output)
+					&& (job.last ? stream.finish(output) : stream.flush(output));
+			}
+
+			// Sync flushed blocks concatenate into a single valid deflate stream
+			std::vector<deflate_job> create_deflate_jobs(const std::string& data, const bool split)
+			{
+				std::vector<deflate_job> jobs{};
+				if (!split || data.size() <= parallel_block_size)
+				{
+					auto& job = jobs.emplace_back();
+					job.input = data;
+					job.last = true;
+					return jobs;
+				}
+
+				const std::string_view input{data};
+				jobs.reserve((input.size() + parallel_block_size - 1) / parallel_block_size);
 
-			return buffer;
-		}
+				for (size_t offset = 0; offset < input.size(); offset += parallel_block_size)
+				{
+					const auto dictionary_start = offset - std::min(offset, block_dictionary_size);
 
-		std::string compress(const std::string& data)
-		{
-			std::string result{};
-			auto length = compressBound(static_cast<uLong>(data.size()));
-			result.resize(length);
+					auto& job = jobs.emplace_back();
+					job.input = input.substr(offset, parallel_block_size);
+					job.dictionary = input.substr(dictionary_start, offset - dictionary_start);
+					job.last = offset + parallel_block_size >= input.size();
+				}
 
-			if (compress2(reinterpret_cast<Bytef*>(result.data()), &length,
-			              reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()),
-			              Z_BEST_COMPRESSION) != Z_OK)
-			{
-				return {};
+				return jobs;
 			}
 
-			result.resize(length);
-			return result;
-		}
-	}
-
-	namespace zip
-	{
-		namespace
-		{
-			bool add_file(zipFile& zip_file, const std::string& filename, const std::string& data)
+			bool add_file(zipFile& zip_file, const std::string& filename, const std::string& data,
+			              const std::vector<deflate_job>& jobs, const int level)
 			{
+				auto crc = jobs.front().crc;
+				for (size_t i = 1; i < jobs.size(); ++i)
+				{
+					crc = crc32_combine(crc, jobs[i].crc, static_cast<z_off_t>(jobs[i].input.size()));
+				}
+
 				const auto zip_64 = data.size() > 0xffffffff ? 1 : 0;
-				if (ZIP_OK != zipOpenNewFileInZip64(zip_file, filename.data(), nullptr, nullptr, 0, nullptr, 0, nullptr,
-				                                    Z_DEFLATED, Z_BEST_COMPRESSION, zip_64))
+				if (ZIP_OK != zipOpenNewFileInZip2_64(zip_file, filename.data(), nullptr, nullptr, 0, nullptr, 0,
+				                                      nullptr, Z_DEFLATED, level, 1, zip_64))
 				{
 					return false;
 				}
 
-				const auto _ = finally([&zip_file]()
+				auto success = true;
+				for (const auto& job : jobs)
 				{
-					zipCloseFileInZip(zip_file);
-				});
+					for (size_t offset = 0; success && offset < job.output.size();)
+					{
+						const auto slice = zlib::get_slice(job.output.size() - offset);
+						success = ZIP_OK == zipWriteInFileInZip(zip_file, job.output.data() + offset, slice);
+						offset += slice;
+					}
+				}
 
-				return ZIP_OK == zipWriteInFileInZip(zip_file, data.data(), static_cast<unsigned>(data.size()));
+				return ZIP_OK == zipCloseFileInZipRaw64(zip_file, data.size(), crc) && success;
 			}
 		}
 
+		archive::archive(const int level)
+			: level_(level)
+		{
+		}
+
 		void archive::add(std::string filename, std::string data)
 		{
 			this->files_[std::move(filename)] = std::move(data);
 		}
 
-		bool archive::write(const std::string& filename, const std::string& comment)
+		bool archive::write(const std::string& filename, const std::string& comment, const size_t thread_count)
 		{
+			const auto split = get_thread_count(thread_count, std::numeric_limits<size_t>::max()) > 1;
+
+			std::vector<std::vector<deflate_job>> files{};
+			files.reserve(this->files_.size());
+
+			std::vector<deflate_job*> jobs{};
+			for (const auto& file : this->files_)
+			{
+				for (auto& job : files.emplace_back(create_deflate_jobs(file.second, split)))
+				{
+					jobs.push_back(&job);
+				}
+			}
+
+			run_jobs(jobs.size(), thread_count, [&](const size_t i)
+			{
+				run_deflate_job(*jobs[i], this->level_);
+			});
+
+			for (const auto* job : jobs)
+			{
+				if (!job->success)
+				{
+					return false;
+				}
+			}
+
 			// Hack to create the directory :3
 			io::write_file(filename, {});
 			io::remove_file(filename);
@@ -155,9 +1217,10 @@ namespace utils::compression
 				zipClose(zip_file, comment.empty() ? nullptr : comment.data());
 			});
 
+			auto file_jobs = files.begin();
 			for (const auto& file : this->files_)
 			{
-				if (!add_file(zip_file, file.first, file.second))
+				if (!add_file(zip_file, file.first, file.second, *file_jobs++, this->level_))
 				{
 					return false;
 				}
@@ -166,231 +1229,504 @@ namespace utils::compression
 			return true;
 		}
 
-		namespace
+		writer::writer(const std::string& filename, const int level)
+			: level_(level)
+		{
+			// Hack to create the directory :3
+			io::write_file(filename, {});
+			io::remove_file(filename);
+
+			this->file_ = zipOpen64(filename.data(), 0);
+		}
+
+		writer::~writer()
+		{
+			this->close();
+		}
+
+		writer::writer(writer&& obj) noexcept
 		{
-			std::optional<std::pair<std::string, std::string>> read_zip_file_entry(unzFile& zip_file)
+			this->operator=(std::move(obj));
+		}
+
+		writer& writer::operator=(writer&& obj) noexcept
+		{
+			if (this != &obj)
 			{
-				char filename[1024]{};
-				unz_file_info file_info{};
-				if (unzGetCurrentFileInfo(zip_file, &file_info, filename, sizeof(filename), nullptr, 0, nullptr, 0) !=
-					UNZ_OK)
-				{
-					return {};
-				}
+				this->close();
+				this->file_ = std::exchange(obj.file_, nullptr);
+				this->level_ = obj.level_;
+			}
 
-				if (unzOpenCurrentFile(zip_file) != UNZ_OK)
-				{
-					return {};
-				}
+			return *this;
+		}
 
-				auto _ = finally([&zip_file]
-				{
-					unzCloseCurrentFile(zip_file);
-				});
+		bool writer::is_valid() const
+		{
+			return this->file_ != nullptr;
+		}
 
-				int error = UNZ_OK;
-				std::string out_buffer{};
-				static thread_local char buffer[0x2000];
+		bool writer::add(const std::string& filename, const std::string_view data)
+		{
+			return this->write_entry(filename, [data](const zlib::sink& output)
+			{
+				return output(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+			}, data.size() > 0xffffffff);
+		}
 
-				do
+		bool writer::add_file(const std::string& filename, const std::string& path)
+		{
+			std::ifstream stream(path, std::ios::binary);
+			if (!stream.is_open())
+			{
+				return false;
+			}
+
+			return this->write_entry(filename, [&stream](const zlib::sink& output)
+			{
+				static thread_local char buffer[0x10000];
+
+				while (stream)
 				{
-					error = unzReadCurrentFile(zip_file, buffer, sizeof(buffer));
-					if (error < 0)
-					{
-						return {};
-					}
+					stream.read(buffer, sizeof(buffer));
 
-					// Write data to file.
-					if (error > 0)
+					const auto length = static_cast<size_t>(stream.gcount());
+					if (length && !output(reinterpret_cast<const uint8_t*>(buffer), length))
 					{
-						out_buffer.append(buffer, error);
+						return false;
 					}
 				}
-				while (error > 0);
 
-				return std::pair<std::string, std::string>{filename, out_buffer};
+				return stream.eof();
+			}, io::file_size(path) > 0xffffffff);
+		}
+
+		bool writer::add_stream(const std::string& filename, const source& input)
+		{
+			// The size is unknown up front, so zip64 fields have to be reserved
+			return this->write_entry(filename, input, true);
+		}
+
+		bool writer::close(const std::string& comment)
+		{
+			if (!this->file_)
+			{
+				return false;
 			}
 
-			class memory_file
+			const auto file = std::exchange(this->file_, nullptr);
+			return zipClose(file, comment.empty() ? nullptr : comment.data()) == ZIP_OK;
+		}
+
+		bool writer::write_entry(const std::string& filename, const source& input, const bool zip_64)
+		{
+			if (!this->file_ || ZIP_OK != zipOpenNewFileInZip64(this->file_, filename.data(), nullptr, nullptr, 0,
+			                                                     nullptr, 0, nullptr, Z_DEFLATED, this->level_,
+			                                                     zip_64 ? 1 : 0))
 			{
-			public:
-				memory_file(const std::string& data)
-					: data_(data)
-				{
-					func_def_.opaque = this;
-					func_def_.zopen64_file = open_file_static;
-					func_def_.zseek64_file = seek_file_static;
-					func_def_.ztell64_file = tell_file_static;
-					func_def_.zread_file = read_file_static;
-					func_def_.zwrite_file = write_file_static;
-					func_def_.zclose_file = close_file_static;
-					func_def_.zerror_file = testerror_file_static;
-				}
+				return false;
+			}
 
-				const char* get_name() const
+			const zlib::sink output = [this](const uint8_t* data, const size_t length)
+			{
+				for (size_t offset = 0; offset < length;)
 				{
-					return "blub";
+					const auto slice = zlib::get_slice(length - offset);
+					if (ZIP_OK != zipWriteInFileInZip(this->file_, data + offset, slice))
+					{
+						return false;
+					}
+
+					offset += slice;
 				}
 
-				zlib_filefunc64_def* get_func_def()
+				return true;
+			};
+
+			const auto success = input(output);
+			return ZIP_OK == zipCloseFileInZip(this->file_) && success;
+		}
+
+		namespace
+		{
+			constexpr uint32_t local_header_signature = 0x04034b50;
+			constexpr uint32_t central_header_signature = 0x02014b50;
+			constexpr uint32_t end_signature = 0x06054b50;
+			constexpr uint32_t zip64_end_signature = 0x06064b50;
+			constexpr uint32_t zip64_locator_signature = 0x07064b50;
+
+			constexpr size_t local_header_size = 30;
+			constexpr size_t central_header_size = 46;
+			constexpr size_t end_size = 22;
+			constexpr size_t zip64_end_size = 56;
+			constexpr size_t zip64_locator_size = 20;
+			constexpr size_t max_comment_size = 0xFFFF;
+
+			constexpr uint16_t method_stored = 0;
+			constexpr uint16_t method_deflated = 8;
+			constexpr uint16_t flag_encrypted = 1;
+
+			// Deflate can't expand data by more than this, larger sizes are bogus
+			constexpr uint64_t max_deflate_ratio = 1032;
+
+			template <typename T>
+			T read_le(const std::string_view data, const size_t offset)
+			{
+				T value{};
+				memcpy(&value, data.data() + offset, sizeof(value));
+				return value;
+			}
+
+			size_t find_end_record(const std::string_view data)
+			{
+				if (data.size() < end_size)
 				{
-					return &this->func_def_;
+					return std::string_view::npos;
 				}
 
-			private:
-				const std::string& data_;
-				size_t offset_{0};
-				zlib_filefunc64_def func_def_{};
+				const auto last = data.size() - end_size;
+				const auto first = last > max_comment_size ? last - max_comment_size : 0;
 
-				voidpf open_file(const void* filename, const int mode) const
+				for (auto offset = last + 1; offset-- > first;)
 				{
-					if (mode != (ZLIB_FILEFUNC_MODE_READ | ZLIB_FILEFUNC_MODE_EXISTING))
+					if (read_le<uint32_t>(data, offset) == end_signature)
 					{
-						return nullptr;
+						return offset;
 					}
+				}
 
-					if (strcmp(static_cast<const char*>(filename), get_name()) != 0)
-					{
-						return nullptr;
-					}
+				return std::string_view::npos;
+			}
 
-					return reinterpret_cast<voidpf>(1);
-				}
+			// Replaces saturated 32 bit fields with the values from the zip64 extra field
+			bool read_zip64_extra(const std::string_view extra, reader::entry& entry)
+			{
+				uint64_t* fields[] = {&entry.size, &entry.compressed_size, &entry.header_offset};
 
-				long seek_file(const voidpf stream, const ZPOS64_T offset, const int origin)
+				for (size_t offset = 0; offset + 4 <= extra.size();)
 				{
-					if (stream != reinterpret_cast<voidpf>(1))
-					{
-						return -1;
-					}
+					const auto id = read_le<uint16_t>(extra, offset);
+					const auto size = read_le<uint16_t>(extra, offset + 2);
+					offset += 4;
 
-					size_t target_base = this->data_.size();
-					if (origin == ZLIB_FILEFUNC_SEEK_CUR)
+					if (offset + size > extra.size())
 					{
-						target_base = this->offset_;
-					}
-					else if (origin == ZLIB_FILEFUNC_SEEK_SET)
-					{
-						target_base = 0;
+						return false;
 					}
 
-					const auto target_offset = target_base + offset;
-					if (target_offset > this->data_.size())
+					if (id == 1)
 					{
-						return -1;
+						size_t field_offset = offset;
+						for (auto* field : fields)
+						{
+							if (*field != 0xFFFFFFFF)
+							{
+								continue;
+							}
+
+							if (field_offset + 8 > offset + size)
+							{
+								return false;
+							}
+
+							*field = read_le<uint64_t>(extra, field_offset);
+							field_offset += 8;
+						}
+
+						return true;
 					}
 
-					this->offset_ = target_offset;
-					return 0;
+					offset += size;
 				}
 
-				ZPOS64_T tell_file(const voidpf stream) const
-				{
-					if (stream != reinterpret_cast<voidpf>(1))
-					{
-						return static_cast<ZPOS64_T>(-1);
-					}
+				return true;
+			}
+		}
 
-					return this->offset_;
-				}
+		reader::reader(const std::string_view data)
+			: data_(data)
+		{
+			this->valid_ = this->parse();
+		}
 
-				uLong read_file(const voidpf stream, void* buf, const uLong size)
-				{
-					if (stream != reinterpret_cast<voidpf>(1))
-					{
-						return 0;
-					}
+		reader reader::open(const std::string& file)
+		{
+			reader reader{};
+			reader.file_ = io::mapped_file(file);
 
-					const auto file_end = this->data_.size();
-					const auto start = this->offset_;
-					const auto end = std::min(this->offset_ + size, file_end);
-					const auto length = end - start;
+			if (reader.file_.is_valid())
+			{
+				reader.data_ = reader.file_.get_data();
+				reader.valid_ = reader.parse();
+			}
 
-					memcpy(buf, this->data_.data() + start, length);
-					this->offset_ = end;
+			return reader;
+		}
 
-					return static_cast<uLong>(length);
-				}
+		bool reader::is_valid() const
+		{
+			return this->valid_;
+		}
+
+		size_t reader::size() const
+		{
+			return this->entries_.size();
+		}
+
+		const std::vector<reader::entry>& reader::get_entries() const
+		{
+			return this->entries_;
+		}
+
+		const reader::entry* reader::find(const std::string_view name) const
+		{
+			const auto entry = this->index_.find(name);
+			if (entry == this->index_.end())
+			{
+				return nullptr;
+			}
+
+			return &this->entries_[entry->second];
+		}
+
+		std::optional<std::string> reader::read(const std::string_view name) const
+		{
+			const auto* entry = this->find(name);
+			if (!entry)
+			{
+				return {};
+			}
+
+			return this->read(*entry);
+		}
+
+		std::optional<std::string> reader::read(const entry& entry) const
+		{
+			if (entry.size / max_deflate_ratio > entry.compressed_size)
+			{
+				return {};
+			}
 
-				static voidpf open_file_static(const voidpf opaque, const void* filename, const int mode)
+			std::string data{};
+			data.resize(entry.size);
+
+			if (!this->read(entry, data.data(), data.size()))
+			{
+				return {};
+			}
+
+			return data;
+		}
+
+		std::optional<size_t> reader::read(const entry& entry, void* output, const size_t capacity) const
+		{
+			if (entry.size > capacity)
+			{
+				return {};
+			}
+
+			const auto data = this->get_entry_data(entry);
+			if (!data)
+			{
+				return {};
+			}
+
+			if (entry.method == method_stored)
+			{
+				if (data->size() != entry.size)
 				{
-					return static_cast<memory_file*>(opaque)->open_file(filename, mode);
+					return {};
 				}
 
-				static long seek_file_static(const voidpf opaque, const voidpf stream, const ZPOS64_T offset,
-				                             const int origin)
+				std::copy(data->begin(), data->end(), static_cast<char*>(output));
+			}
+			else
+			{
+				auto& stream = zlib::get_raw_inflate_stream();
+				const auto size = stream.decompress(*data, output, static_cast<size_t>(entry.size));
+				if (!size || *size != entry.size)
 				{
-					return static_cast<memory_file*>(opaque)->seek_file(stream, offset, origin);
+					return {};
 				}
+			}
+
+			if (update_crc(0, output, static_cast<size_t>(entry.size)) != entry.crc)
+			{
+				return {};
+			}
+
+			return static_cast<size_t>(entry.size);
+		}
+
+		bool reader::read(const entry& entry, const zlib::sink& output) const
+		{
+			const auto data = this->get_entry_data(entry);
+			if (!data)
+			{
+				return false;
+			}
+
+			uint32_t crc = 0;
+			uint64_t size = 0;
+
+			const zlib::sink checked_output = [&](const uint8_t* chunk, const size_t length)
+			{
+				crc = update_crc(crc, chunk, length);
+				size += length;
+				return size <= entry.size && output(chunk, length);
+			};
 
-				static ZPOS64_T tell_file_static(const voidpf opaque, const voidpf stream)
+			if (entry.method == method_stored)
+			{
+				if (!data->empty() && !checked_output(reinterpret_cast<const uint8_t*>(data->data()), data->size()))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				// The sink might read other entries, so the thread's shared stream can't be used here
+				zlib::inflate_stream stream{zlib::format::raw};
+				if (!stream.write(*data, checked_output) || !stream.is_finished())
 				{
-					return static_cast<memory_file*>(opaque)->tell_file(stream);
+					return false;
 				}
+			}
+
+			return size == entry.size && crc == entry.crc;
+		}
+
+		bool reader::parse()
+		{
+			const auto end_offset = find_end_record(this->data_);
+			if (end_offset == std::string_view::npos)
+			{
+				return false;
+			}
 
-				static uLong read_file_static(const voidpf opaque, const voidpf stream, void* buf, const uLong size)
+			uint64_t count = read_le<uint16_t>(this->data_, end_offset + 10);
+			uint64_t directory_size = read_le<uint32_t>(this->data_, end_offset + 12);
+			uint64_t directory_offset = read_le<uint32_t>(this->data_, end_offset + 16);
+
+			if ((count == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF)
+				&& end_offset >= zip64_locator_size)
+			{
+				const auto locator_offset = end_offset - zip64_locator_size;
+				if (read_le<uint32_t>(this->data_, locator_offset) == zip64_locator_signature)
 				{
-					return static_cast<memory_file*>(opaque)->read_file(stream, buf, size);
+					const auto zip64_end_offset = read_le<uint64_t>(this->data_, locator_offset + 8);
+					if (locator_offset < zip64_end_size || zip64_end_offset > locator_offset - zip64_end_size
+						|| read_le<uint32_t>(this->data_, zip64_end_offset) != zip64_end_signature)
+					{
+						return false;
+					}
+
+					count = read_le<uint64_t>(this->data_, zip64_end_offset + 32);
+					directory_size = read_le<uint64_t>(this->data_, zip64_end_offset + 40);
+					directory_offset = read_le<uint64_t>(this->data_, zip64_end_offset + 48);
 				}
+			}
+
+			if (directory_offset > this->data_.size() || directory_size > this->data_.size() - directory_offset)
+			{
+				return false;
+			}
+
+			const auto directory = this->data_.substr(directory_offset, directory_size);
+
+			const auto max_count = directory.size() / central_header_size;
+			this->entries_.reserve(static_cast<size_t>(std::min<uint64_t>(count, max_count)));
+			this->index_.reserve(this->entries_.capacity());
 
-				static uLong write_file_static(voidpf, voidpf, const void*, uLong)
+			size_t offset = 0;
+			for (uint64_t i = 0; i < count; ++i)
+			{
+				if (directory.size() - offset < central_header_size
+					|| read_le<uint32_t>(directory, offset) != central_header_signature)
 				{
-					return 0;
+					return false;
 				}
 
-				static int close_file_static(voidpf, voidpf)
+				entry entry{};
+				entry.flags = read_le<uint16_t>(directory, offset + 8);
+				entry.method = read_le<uint16_t>(directory, offset + 10);
+				entry.crc = read_le<uint32_t>(directory, offset + 16);
+				entry.compressed_size = read_le<uint32_t>(directory, offset + 20);
+				entry.size = read_le<uint32_t>(directory, offset + 24);
+				entry.header_offset = read_le<uint32_t>(directory, offset + 42);
+
+				const size_t name_length = read_le<uint16_t>(directory, offset + 28);
+				const size_t extra_length = read_le<uint16_t>(directory, offset + 30);
+				const size_t comment_length = read_le<uint16_t>(directory, offset + 32);
+
+				offset += central_header_size;
+				if (directory.size() - offset < name_length + extra_length + comment_length)
 				{
-					return 0;
+					return false;
 				}
 
-				static int testerror_file_static(voidpf, voidpf)
+				entry.name = directory.substr(offset, name_length);
+				if (!read_zip64_extra(directory.substr(offset + name_length, extra_length), entry))
 				{
-					return 0;
+					return false;
 				}
-			};
+
+				offset += name_length + extra_length + comment_length;
+
+				// Later entries win, just like extracting them in order would
+				this->index_[entry.name] = this->entries_.size();
+				this->entries_.push_back(entry);
+			}
+
+			return true;
 		}
 
-		std::unordered_map<std::string, std::string> extract(const std::string& data)
+		std::optional<std::string_view> reader::get_entry_data(const entry& entry) const
 		{
-			memory_file mem_file(data);
-
-			auto zip_file = unzOpen2_64(mem_file.get_name(), mem_file.get_func_def());
-			auto _ = finally([&zip_file]
+			if (!this->valid_ || (entry.flags & flag_encrypted)
+				|| (entry.method != method_stored && entry.method != method_deflated))
 			{
-				if (zip_file)
-				{
-					unzClose(zip_file);
-				}
-			});
+				return {};
+			}
 
-			if (!zip_file)
+			if (this->data_.size() < local_header_size || entry.header_offset > this->data_.size() - local_header_size
+				|| read_le<uint32_t>(this->data_, entry.header_offset) != local_header_signature)
 			{
 				return {};
 			}
 
-			unz_global_info global_info{};
-			if (unzGetGlobalInfo(zip_file, &global_info) != UNZ_OK)
+			const auto name_length = read_le<uint16_t>(this->data_, entry.header_offset + 26);
+			const auto extra_length = read_le<uint16_t>(this->data_, entry.header_offset + 28);
+			const auto data_offset = entry.header_offset + local_header_size + name_length + extra_length;
+
+			if (data_offset > this->data_.size() || entry.compressed_size > this->data_.size() - data_offset)
 			{
 				return {};
 			}
 
-			std::unordered_map<std::string, std::string> files{};
-			files.reserve(global_info.number_entry);
+			return this->data_.substr(data_offset, entry.compressed_size);
+		}
+
+		std::unordered_map<std::string, std::string> extract(const std::string& data, const size_t thread_count)
+		{
+			const reader reader{data};
+			const auto& entries = reader.get_entries();
 
-			for (auto i = 0ul; i < global_info.number_entry; ++i)
+			std::vector<std::optional<std::string>> contents(entries.size());
+			run_jobs(entries.size(), thread_count, [&](const size_t i)
 			{
-				if (i > 0 && unzGoToNextFile(zip_file) != UNZ_OK)
-				{
-					break;
-				}
+				contents[i] = reader.read(entries[i]);
+			});
 
-				auto file = read_zip_file_entry(zip_file);
-				if (!file)
+			std::unordered_map<std::string, std::string> files{};
+			files.reserve(entries.size());
+
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				if (contents[i])
 				{
-					continue;
+					files[std::string(entries[i].name)] = std::move(*contents[i]);
 				}
-
-				files[std::move(file->first)] = std::move(file->second);
 			}
 
 			return files;
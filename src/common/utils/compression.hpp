@@ -1,7 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
+
+#include "io.hpp"
 
 #define CHUNK 16384u
 
@@ -9,22 +17,282 @@ namespace utils::compression
 {
 	namespace zlib
 	{
-		std::string compress(const std::string& data);
-		std::string decompress(const std::string& data);
+		constexpr int default_compression = -1;
+		constexpr int best_speed = 1;
+		constexpr int best_compression = 9;
+
+		enum class strategy
+		{
+			standard,
+			filtered,
+			huffman_only,
+			rle,
+			fixed,
+		};
+
+		// zlib wraps the deflate data with a header and checksum, raw is what zip and similar containers store
+		enum class format
+		{
+			zlib,
+			raw,
+		};
+
+		// Receives produced data in chunks, returning false aborts the stream
+		using sink = std::function<bool(const uint8_t* data, size_t length)>;
+
+		// The underlying z_stream is kept and reset between streams instead of being recreated
+		class deflate_stream
+		{
+		public:
+			deflate_stream(int level = best_compression, strategy strategy = strategy::standard,
+			               format format = format::zlib);
+			~deflate_stream();
+
+			deflate_stream(deflate_stream&& obj) noexcept;
+			deflate_stream& operator=(deflate_stream&& obj) noexcept;
+
+			deflate_stream(const deflate_stream&) = delete;
+			deflate_stream& operator=(const deflate_stream&) = delete;
+
+			bool is_valid() const;
+			bool set_params(int level, strategy strategy);
+			void reset();
+
+			// Primes the window with data both sides know, has to happen before anything is written
+			bool set_dictionary(std::string_view dictionary);
+
+			// Upper bound for the compressed size of length bytes with the current parameters
+			size_t get_bound(size_t length);
+
+			bool write(std::string_view input, const sink& output);
+
+			// Emits everything written so far, ending on a byte boundary without ending the stream
+			bool flush(const sink& output);
+
+			// Flushes the remaining data and resets the stream for the next use
+			bool finish(const sink& output);
+
+			// One-shot compression, output is sized once and reused across calls
+			bool compress(std::string_view input, std::string& output);
+			std::optional<size_t> compress(std::string_view input, void* output, size_t capacity);
+
+		private:
+			struct state;
+			std::unique_ptr<state> state_;
+
+			bool run(std::string_view input, int flush, const sink& output);
+		};
+
+		class inflate_stream
+		{
+		public:
+			inflate_stream(format format = format::zlib);
+			~inflate_stream();
+
+			inflate_stream(inflate_stream&& obj) noexcept;
+			inflate_stream& operator=(inflate_stream&& obj) noexcept;
+
+			inflate_stream(const inflate_stream&) = delete;
+			inflate_stream& operator=(const inflate_stream&) = delete;
+
+			bool is_valid() const;
+			bool is_finished() const;
+			void reset();
+
+			// Only raw streams take the dictionary up front, it has to be set again after every reset
+			bool set_dictionary(std::string_view dictionary);
+
+			// Fails on corrupt data, anything after the end of the stream is ignored
+			bool write(std::string_view input, const sink& output);
+
+			// One-shot decompression, size_hint should be the decompressed size if it is known
+			bool decompress(std::string_view input, std::string& output, size_t size_hint = 0);
+			std::optional<size_t> decompress(std::string_view input, void* output, size_t capacity);
+
+		private:
+			struct state;
+			std::unique_ptr<state> state_;
+		};
+
+		std::string compress(const std::string& data, int level = best_compression);
+		std::string decompress(const std::string& data, size_t size_hint = 0);
 	}
 
+	// LZ4 block format, much faster than zlib at a lower ratio
+	namespace lz4
+	{
+		size_t get_bound(size_t length);
+
+		std::optional<size_t> compress(std::string_view input, void* output, size_t capacity);
+		std::optional<size_t> decompress(std::string_view input, void* output, size_t capacity);
+	}
+
+	enum class codec_type : uint8_t
+	{
+		none = 0,
+		zlib = 1,
+		lz4 = 2,
+	};
+
+	class codec
+	{
+	public:
+		virtual ~codec() = default;
+
+		virtual codec_type get_type() const = 0;
+		virtual size_t get_bound(size_t length) const = 0;
+
+		// The level is codec specific and ignored by codecs without levels
+		virtual std::optional<size_t> compress(std::string_view input, void* output, size_t capacity,
+		                                       int level) const = 0;
+		virtual std::optional<size_t> decompress(std::string_view input, void* output, size_t capacity) const = 0;
+	};
+
+	const codec* get_codec(codec_type type);
+
+	// Frames carry the codec and the original size, so readers don't need to know how data was compressed.
+	// Data that does not shrink is stored as is.
+	std::string compress(std::string_view data, codec_type type = codec_type::lz4,
+	                     int level = zlib::default_compression);
+
+	// Data without a frame is treated as a plain zlib stream
+	std::optional<std::string> decompress(std::string_view data);
+
+	constexpr size_t max_dictionary_size = 1u << 15;
+
+	// The id is written into every frame, so readers can tell dictionary versions apart
+	struct dictionary
+	{
+		uint32_t id{};
+		std::string data{};
+	};
+
+	// Builds a dictionary out of the segments that repeat the most across the samples
+	dictionary train_dictionary(uint32_t id, const std::vector<std::string>& samples,
+	                            size_t size = max_dictionary_size);
+
+	// Lets readers holding several dictionary versions pick the right one
+	std::optional<uint32_t> get_dictionary_id(std::string_view data);
+
+	// Small messages barely compress on their own, a shared dictionary gives them history to refer to.
+	// The streams are kept across messages and only primed again, frames use the zlib codec.
+	class dictionary_compressor
+	{
+	public:
+		dictionary_compressor(dictionary dictionary, int level = zlib::best_compression);
+
+		const dictionary& get_dictionary() const;
+
+		std::string compress(std::string_view data);
+
+		// Frames without a dictionary are accepted as well
+		std::optional<std::string> decompress(std::string_view data);
+
+	private:
+		dictionary dictionary_;
+		zlib::deflate_stream deflate_;
+		zlib::inflate_stream inflate_;
+	};
+
 	namespace zip
 	{
+		// Keeps every file in memory until it is written, use writer for large archives
 		class archive
 		{
 		public:
+			archive(int level = zlib::best_compression);
+
 			void add(std::string filename, std::string data);
-			bool write(const std::string& filename, const std::string& comment = {});
+
+			// Entries are deflated on up to thread_count threads before being written in order,
+			// large entries are split into blocks so they can be deflated in parallel as well.
+			// A thread_count of 0 uses all hardware threads.
+			bool write(const std::string& filename, const std::string& comment = {}, size_t thread_count = 1);
 
 		private:
+			int level_{};
 			std::unordered_map<std::string, std::string> files_;
 		};
 
-		std::unordered_map<std::string, std::string> extract(const std::string& data);
+		// Pushes an entry's data into the given sink chunk by chunk
+		using source = std::function<bool(const zlib::sink& output)>;
+
+		// Writes entries to the file as they are added, only the central directory is kept in memory
+		class writer
+		{
+		public:
+			writer(const std::string& filename, int level = zlib::best_compression);
+			~writer();
+
+			writer(writer&& obj) noexcept;
+			writer& operator=(writer&& obj) noexcept;
+
+			writer(const writer&) = delete;
+			writer& operator=(const writer&) = delete;
+
+			bool is_valid() const;
+
+			bool add(const std::string& filename, std::string_view data);
+			bool add_file(const std::string& filename, const std::string& path);
+			bool add_stream(const std::string& filename, const source& input);
+
+			// Writes the central directory, happens on destruction otherwise
+			bool close(const std::string& comment = {});
+
+		private:
+			void* file_{};
+			int level_{};
+
+			bool write_entry(const std::string& filename, const source& input, bool zip_64);
+		};
+
+		// Parses the central directory only, entries are inflated when they are read.
+		// Readers over a buffer reference it, so the buffer has to outlive the reader.
+		class reader
+		{
+		public:
+			struct entry
+			{
+				std::string_view name{};
+				uint64_t compressed_size{};
+				uint64_t size{};
+				uint64_t header_offset{};
+				uint32_t crc{};
+				uint16_t method{};
+				uint16_t flags{};
+			};
+
+			reader() = default;
+			reader(std::string_view data);
+
+			static reader open(const std::string& file);
+
+			bool is_valid() const;
+			size_t size() const;
+			const std::vector<entry>& get_entries() const;
+			const entry* find(std::string_view name) const;
+
+			std::optional<std::string> read(std::string_view name) const;
+			std::optional<std::string> read(const entry& entry) const;
+
+			// Fails if the entry does not fit into the buffer, returns the entry size otherwise
+			std::optional<size_t> read(const entry& entry, void* output, size_t capacity) const;
+
+			// Streams the entry in chunks, the checksum is only verified once everything was passed on
+			bool read(const entry& entry, const zlib::sink& output) const;
+
+		private:
+			io::mapped_file file_{};
+			std::string_view data_{};
+			bool valid_{};
+			std::vector<entry> entries_{};
+			std::unordered_map<std::string_view, size_t> index_{};
+
+			bool parse();
+			std::optional<std::string_view> get_entry_data(const entry& entry) const;
+		};
+
+		// Entries are inflated on up to thread_count threads, 0 uses all hardware threads
+		std::unordered_map<std::string, std::string> extract(const std::string& data, size_t thread_count = 1);
 	}
 };
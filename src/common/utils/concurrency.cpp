@@ -0,0 +1,119 @@
+#include "concurrency.hpp"
+
+#ifdef LOCK_INSTRUMENTATION
+#include <algorithm>
+#include <cstring>
+
+namespace utils::concurrency
+{
+	namespace
+	{
+		// Entries are never removed, so readers can walk the list without locking
+		std::atomic<lock_stats*> lock_stats_head{};
+
+		std::mutex& get_registry_mutex()
+		{
+			static std::mutex registry_mutex{};
+			return registry_mutex;
+		}
+
+		template <typename Matches>
+		lock_stats* find_lock_stats(const Matches& matches)
+		{
+			for (auto* entry = lock_stats_head.load(std::memory_order_acquire); entry; entry = entry->next)
+			{
+				if (matches(*entry))
+				{
+					return entry;
+				}
+			}
+
+			return nullptr;
+		}
+
+		// Constructing a lock only takes the registry mutex the first time its key shows up
+		template <typename Matches, typename Initialize>
+		lock_stats& find_or_add(const Matches& matches, const Initialize& initialize)
+		{
+			if (auto* entry = find_lock_stats(matches))
+			{
+				return *entry;
+			}
+
+			std::lock_guard _(get_registry_mutex());
+
+			if (auto* entry = find_lock_stats(matches))
+			{
+				return *entry;
+			}
+
+			auto* entry = new lock_stats();
+			initialize(*entry);
+			entry->next = lock_stats_head.load(std::memory_order_relaxed);
+			lock_stats_head.store(entry, std::memory_order_release);
+
+			return *entry;
+		}
+	}
+
+	void lock_stats::record_contention(const std::chrono::nanoseconds wait_time)
+	{
+		const auto wait = static_cast<uint64_t>(std::max(wait_time, std::chrono::nanoseconds::zero()).count());
+
+		this->contended.fetch_add(1, std::memory_order_relaxed);
+		this->total_wait.fetch_add(wait, std::memory_order_relaxed);
+
+		auto current = this->max_wait.load(std::memory_order_relaxed);
+		while (current < wait && !this->max_wait.compare_exchange_weak(current, wait, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	lock_stats& get_lock_stats(const std::string_view name)
+	{
+		const auto matches = [name](const lock_stats& entry)
+		{
+			return !entry.file && entry.name == name;
+		};
+
+		return find_or_add(matches, [name](lock_stats& entry)
+		{
+			entry.name = name;
+		});
+	}
+
+	lock_stats& get_lock_stats(const std::source_location& location)
+	{
+		// The file name usually has one address per translation unit, the string compare is the fallback
+		const auto matches = [&location](const lock_stats& entry)
+		{
+			return entry.file && entry.line == location.line()
+				&& (entry.file == location.file_name() || strcmp(entry.file, location.file_name()) == 0);
+		};
+
+		return find_or_add(matches, [&location](lock_stats& entry)
+		{
+			std::string name = location.file_name();
+
+			const auto separator = name.find_last_of("\\/");
+			if (separator != std::string::npos)
+			{
+				name.erase(0, separator + 1);
+			}
+
+			entry.name = name + ":" + std::to_string(location.line());
+			entry.file = location.file_name();
+			entry.line = location.line();
+		});
+	}
+
+	void for_each_lock_stats(const std::function<void(const lock_stats&)>& callback)
+	{
+		for (auto* entry = lock_stats_head.load(std::memory_order_acquire); entry; entry = entry->next)
+		{
+			callback(*entry);
+		}
+	}
+}
+
+#endif
@@ -1,38 +1,190 @@
 #pragma once
 
 #include <mutex>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+
+#ifdef LOCK_INSTRUMENTATION
+#include <chrono>
+#include <functional>
+#include <source_location>
+#include <string>
+#endif
+
+#include <string_view>
 
 namespace utils::concurrency
 {
+#ifdef LOCK_INSTRUMENTATION
+	// Per-lock statistics, all times are in nanoseconds.
+	// Locks with the same name or constructed at the same location share one entry.
+	struct lock_stats
+	{
+		std::string name{};
+		std::atomic<uint64_t> acquisitions{};
+		std::atomic<uint64_t> contended{};
+		std::atomic<uint64_t> total_wait{};
+		std::atomic<uint64_t> max_wait{};
+		lock_stats* next{};
+
+		// Location key of unnamed locks, compared without building the name
+		const char* file{};
+		uint_least32_t line{};
+
+		void record_contention(std::chrono::nanoseconds wait_time);
+	};
+
+	// Existing entries are found without locking, only the first lookup of a key registers it
+	lock_stats& get_lock_stats(std::string_view name);
+	lock_stats& get_lock_stats(const std::source_location& location);
+	void for_each_lock_stats(const std::function<void(const lock_stats&)>& callback);
+
+	// Drop-in replacement for any mutex type that records how often and how long it was waited for
+	template <typename MutexType>
+	class instrumented_mutex
+	{
+	public:
+		instrumented_mutex(const std::source_location& location = std::source_location::current())
+			: stats_(&get_lock_stats(location))
+		{
+		}
+
+		instrumented_mutex(const std::string_view name)
+			: stats_(&get_lock_stats(name))
+		{
+		}
+
+		instrumented_mutex(const instrumented_mutex&) = delete;
+		instrumented_mutex& operator=(const instrumented_mutex&) = delete;
+
+		void lock()
+		{
+			if (!this->mutex_.try_lock())
+			{
+				const auto start = std::chrono::steady_clock::now();
+				this->mutex_.lock();
+				this->stats_->record_contention(std::chrono::steady_clock::now() - start);
+			}
+
+			this->stats_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		bool try_lock()
+		{
+			if (!this->mutex_.try_lock())
+			{
+				return false;
+			}
+
+			this->stats_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		void unlock()
+		{
+			this->mutex_.unlock();
+		}
+
+		void lock_shared() requires requires(MutexType& m) { m.lock_shared(); }
+		{
+			if (!this->mutex_.try_lock_shared())
+			{
+				const auto start = std::chrono::steady_clock::now();
+				this->mutex_.lock_shared();
+				this->stats_->record_contention(std::chrono::steady_clock::now() - start);
+			}
+
+			this->stats_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		bool try_lock_shared() requires requires(MutexType& m) { m.try_lock_shared(); }
+		{
+			if (!this->mutex_.try_lock_shared())
+			{
+				return false;
+			}
+
+			this->stats_->acquisitions.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		void unlock_shared() requires requires(MutexType& m) { m.unlock_shared(); }
+		{
+			this->mutex_.unlock_shared();
+		}
+
+	private:
+		MutexType mutex_{};
+		lock_stats* stats_{};
+	};
+
+	template <typename MutexType>
+	using lock_type = instrumented_mutex<MutexType>;
+
+	using mutex = instrumented_mutex<std::mutex>;
+	using recursive_mutex = instrumented_mutex<std::recursive_mutex>;
+	using shared_mutex = instrumented_mutex<std::shared_mutex>;
+#else
+	template <typename MutexType>
+	using lock_type = MutexType;
+
+	using mutex = std::mutex;
+	using recursive_mutex = std::recursive_mutex;
+	using shared_mutex = std::shared_mutex;
+#endif
+
 	template <typename T, typename MutexType = std::mutex>
 	class container
 	{
 	public:
+		// Without a name, the stats are keyed on the construction site. Members of another class
+		// all report the location of that class's constructor, so they should be named.
+#ifdef LOCK_INSTRUMENTATION
+		container(const std::source_location& location = std::source_location::current())
+			: mutex_(location)
+		{
+		}
+
+		explicit container(const std::string_view name)
+			: mutex_(name)
+		{
+		}
+#else
+		container() = default;
+
+		explicit container(std::string_view /*name*/)
+		{
+		}
+#endif
+
 		template <typename R = void, typename F>
 		R access(F&& accessor) const
 		{
-			std::lock_guard<MutexType> _{mutex_};
+			std::lock_guard<lock_type<MutexType>> _{mutex_};
 			return accessor(object_);
 		}
 
 		template <typename R = void, typename F>
 		R access(F&& accessor)
 		{
-			std::lock_guard<MutexType> _{mutex_};
+			std::lock_guard<lock_type<MutexType>> _{mutex_};
 			return accessor(object_);
 		}
 
 		template <typename R = void, typename F>
 		R access_with_lock(F&& accessor) const
 		{
-			std::unique_lock<MutexType> lock{mutex_};
+			std::unique_lock<lock_type<MutexType>> lock{mutex_};
 			return accessor(object_, lock);
 		}
 
 		template <typename R = void, typename F>
 		R access_with_lock(F&& accessor)
 		{
-			std::unique_lock<MutexType> lock{mutex_};
+			std::unique_lock<lock_type<MutexType>> lock{mutex_};
 			return accessor(object_, lock);
 		}
 
@@ -40,7 +192,322 @@ namespace utils::concurrency
 		const T& get_raw() const { return object_; }
 
 	private:
-		mutable MutexType mutex_{};
+		mutable lock_type<MutexType> mutex_{};
 		T object_{};
 	};
+
+	// Readers share the lock, writers get exclusive access
+	template <typename T, typename MutexType = std::shared_mutex>
+	class shared_container
+	{
+	public:
+#ifdef LOCK_INSTRUMENTATION
+		shared_container(const std::source_location& location = std::source_location::current())
+			: mutex_(location)
+		{
+		}
+
+		explicit shared_container(const std::string_view name)
+			: mutex_(name)
+		{
+		}
+#else
+		shared_container() = default;
+
+		explicit shared_container(std::string_view /*name*/)
+		{
+		}
+#endif
+
+		template <typename R = void, typename F>
+		R access_shared(F&& accessor) const
+		{
+			std::shared_lock<lock_type<MutexType>> _{mutex_};
+			return accessor(static_cast<const T&>(object_));
+		}
+
+		template <typename R = void, typename F>
+		R access(F&& accessor) const
+		{
+			return this->access_shared<R>(std::forward<F>(accessor));
+		}
+
+		template <typename R = void, typename F>
+		R access(F&& accessor)
+		{
+			std::lock_guard<lock_type<MutexType>> _{mutex_};
+			return accessor(object_);
+		}
+
+		template <typename R = void, typename F>
+		R access_with_lock(F&& accessor)
+		{
+			std::unique_lock<lock_type<MutexType>> lock{mutex_};
+			return accessor(object_, lock);
+		}
+
+		T& get_raw() { return object_; }
+		const T& get_raw() const { return object_; }
+
+	private:
+		mutable lock_type<MutexType> mutex_{};
+		T object_{};
+	};
+
+	// Publishes immutable versions of the object (RCU-style).
+	// Writers copy the current version, modify it and publish the copy, readers never wait for that.
+	// Loading a version isn't lock-free though: std::atomic<std::shared_ptr> guards the pointer swap
+	// with a short internal lock on MSVC, so readers may briefly spin against a publish or another load.
+	// Readers holding an older version keep it alive until they are done.
+	template <typename T>
+	class snapshot_container
+	{
+	public:
+		snapshot_container()
+			: object_(std::make_shared<const T>())
+		{
+		}
+
+		snapshot_container(T object)
+			: object_(std::make_shared<const T>(std::move(object)))
+		{
+		}
+
+		std::shared_ptr<const T> get() const
+		{
+			return this->object_.load(std::memory_order_acquire);
+		}
+
+		template <typename R = void, typename F>
+		R access(F&& accessor) const
+		{
+			const auto snapshot = this->get();
+			return accessor(*snapshot);
+		}
+
+		// Writers are serialized, so no update gets lost
+		template <typename R = void, typename F>
+		R update(F&& updater)
+		{
+			std::lock_guard<std::mutex> _{write_mutex_};
+
+			auto copy = std::make_shared<T>(*this->get());
+			const auto publish = [&]
+			{
+				this->object_.store(std::move(copy), std::memory_order_release);
+			};
+
+			if constexpr (std::is_void_v<R>)
+			{
+				updater(*copy);
+				publish();
+			}
+			else
+			{
+				R result = updater(*copy);
+				publish();
+				return result;
+			}
+		}
+
+		void set(T object)
+		{
+			std::lock_guard<std::mutex> _{write_mutex_};
+			this->object_.store(std::make_shared<const T>(std::move(object)), std::memory_order_release);
+		}
+
+	private:
+		std::mutex write_mutex_{};
+		std::atomic<std::shared_ptr<const T>> object_{};
+	};
+
+	// Lock-free stack of recycled nodes, linked through their atomic next member.
+	// Its head carries a tag in the unused upper pointer bits, which is bumped on every change to rule out ABA.
+	// Nodes are never freed while the list lives, so a stale entry only fails the exchange.
+	template <typename Node>
+	class free_list
+	{
+	public:
+		free_list() = default;
+
+		~free_list()
+		{
+			auto* entry = get_node(this->head_.load());
+			while (entry)
+			{
+				auto* next = entry->next.load();
+				delete entry;
+				entry = next;
+			}
+		}
+
+		free_list(free_list&&) = delete;
+		free_list(const free_list&) = delete;
+		free_list& operator=(free_list&&) = delete;
+		free_list& operator=(const free_list&) = delete;
+
+		Node* pop()
+		{
+			auto head = this->head_.load(std::memory_order_acquire);
+
+			while (true)
+			{
+				auto* entry = get_node(head);
+				if (!entry)
+				{
+					return nullptr;
+				}
+
+				auto* next = entry->next.load(std::memory_order_relaxed);
+				if (this->head_.compare_exchange_weak(head, make_head(next, head), std::memory_order_acquire,
+				                                      std::memory_order_acquire))
+				{
+					entry->next.store(nullptr, std::memory_order_relaxed);
+					return entry;
+				}
+			}
+		}
+
+		void push(Node* entry)
+		{
+			auto head = this->head_.load(std::memory_order_relaxed);
+
+			do
+			{
+				entry->next.store(get_node(head), std::memory_order_relaxed);
+			}
+			while (!this->head_.compare_exchange_weak(head, make_head(entry, head), std::memory_order_release,
+			                                          std::memory_order_relaxed));
+		}
+
+	private:
+		static constexpr auto pointer_bits = 48;
+		static constexpr auto pointer_mask = (uint64_t(1) << pointer_bits) - 1;
+
+		std::atomic<uint64_t> head_{0};
+
+		static Node* get_node(const uint64_t value)
+		{
+			return reinterpret_cast<Node*>(static_cast<uintptr_t>(value & pointer_mask));
+		}
+
+		static uint64_t make_head(const Node* entry, const uint64_t previous)
+		{
+			const auto tag = (previous >> pointer_bits) + 1;
+			return (tag << pointer_bits) | static_cast<uint64_t>(reinterpret_cast<uintptr_t>(entry));
+		}
+	};
+
+	// Fixed-size blocks that any thread may allocate and free.
+	// Freed blocks are kept for reuse, so the pool only allocates while it grows beyond its previous size.
+	template <size_t Size, size_t Alignment>
+	class block_pool
+	{
+	public:
+		void* allocate()
+		{
+			auto* entry = this->free_.pop();
+			if (!entry)
+			{
+				entry = new block{};
+			}
+
+			return entry->storage;
+		}
+
+		void free(void* memory)
+		{
+			// The storage is the first member, so it shares the block's address
+			this->free_.push(reinterpret_cast<block*>(memory));
+		}
+
+	private:
+		struct block
+		{
+			alignas(Alignment) std::byte storage[Size];
+			std::atomic<block*> next{nullptr};
+		};
+
+		free_list<block> free_{};
+	};
+
+	// Lock-free multi-producer single-consumer queue (Vyukov).
+	// Any thread may push, only the owning thread may pop.
+	// Popped nodes are recycled, so pushing only allocates while the queue grows beyond its previous size.
+	template <typename T>
+	class mpsc_queue
+	{
+	public:
+		mpsc_queue() = default;
+
+		~mpsc_queue()
+		{
+			while (this->pop())
+			{
+			}
+
+			if (this->tail_ != &this->stub_)
+			{
+				delete this->tail_;
+			}
+		}
+
+		mpsc_queue(mpsc_queue&&) = delete;
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator=(mpsc_queue&&) = delete;
+		mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+		void push(T value)
+		{
+			auto* entry = this->free_.pop();
+			if (!entry)
+			{
+				entry = new node{};
+			}
+
+			entry->value.emplace(std::move(value));
+
+			auto* previous = this->head_.exchange(entry, std::memory_order_acq_rel);
+			previous->next.store(entry, std::memory_order_release);
+		}
+
+		std::optional<T> pop()
+		{
+			auto* tail = this->tail_;
+			auto* next = tail->next.load(std::memory_order_acquire);
+			if (!next)
+			{
+				return {};
+			}
+
+			// The popped node becomes the new stub
+			std::optional<T> value{std::move(next->value)};
+			next->value.reset();
+			this->tail_ = next;
+
+			if (tail != &this->stub_)
+			{
+				this->free_.push(tail);
+			}
+
+			return value;
+		}
+
+		bool empty() const
+		{
+			return !this->tail_->next.load(std::memory_order_acquire);
+		}
+
+	private:
+		struct node
+		{
+			std::atomic<node*> next{nullptr};
+			std::optional<T> value{};
+		};
+
+		node stub_{};
+		std::atomic<node*> head_{&stub_};
+		node* tail_{&stub_};
+		free_list<node> free_{};
+	};
 }
@@ -42,7 +42,7 @@ namespace utils::flags
 
 		for (const auto& entry : enabled_flags)
 		{
-			if (string::to_lower(entry) == string::to_lower(flag))
+			if (string::equals_ignore_case(entry, flag))
 			{
 				return true;
 			}
@@ -1,8 +1,14 @@
 #include "hook.hpp"
 
 #include <map>
+#include <intrin.h>
 #include <MinHook.h>
 
+extern "C"
+{
+#include <hde/hde64.h>
+}
+
 #include "concurrency.hpp"
 #include "string.hpp"
 #include "nt.hpp"
@@ -132,9 +138,25 @@ namespace utils::hook
 			size_t offset_{};
 		};
 
+		size_t get_instruction_length(const void* place)
+		{
+			hde64s instruction{};
+			const auto length = hde64_disasm(place, &instruction);
+			return (instruction.flags & F_ERROR) ? 0 : length;
+		}
+
+		// A thread can only be stopped in the middle of the patch if it spans several instructions
+		void verify_atomic_jump(const void* place)
+		{
+			if (!is_atomically_patchable(place, 5) || get_instruction_length(place) < 5)
+			{
+				throw std::runtime_error(string::va("Unable to atomically patch location: %p", place));
+			}
+		}
+
 		void* get_memory_near(const void* address, const size_t size)
 		{
-			static concurrency::container<std::vector<memory>> memory_container{};
+			static concurrency::container<std::vector<memory>> memory_container{"hook::memory"};
 
 			return memory_container.access<void*>([&](std::vector<memory>& memories)
 			{
@@ -155,9 +177,30 @@ namespace utils::hook
 			});
 		}
 
+		// Offset of the absolute target address behind the indirect jump
+		constexpr size_t atomic_trampoline_target = 6;
+
+		// The target address is placed in an aligned 8 byte block, so it can be replaced atomically later on
+		uint8_t* create_atomic_trampoline(const void* place, void* data)
+		{
+			auto* memory = static_cast<uint8_t*>(get_memory_near(place, 14 + 7));
+			if (!memory)
+			{
+				throw std::runtime_error("Too far away to create 32bit relative branch");
+			}
+
+			const auto misalignment = (reinterpret_cast<size_t>(memory) + atomic_trampoline_target) % 8;
+			auto* trampoline = memory + (misalignment ? 8 - misalignment : 0);
+
+			// The trampoline is not reachable before the relative jump is published,
+			// so writing the far jump into it non-atomically is fine
+			jump(trampoline, data, true, true);
+			return trampoline;
+		}
+
 		concurrency::container<std::map<const void*, uint8_t>>& get_original_data_map()
 		{
-			static concurrency::container<std::map<const void*, uint8_t>> og_data{};
+			static concurrency::container<std::map<const void*, uint8_t>> og_data{"hook::original_data"};
 			return og_data;
 		}
 
@@ -274,15 +317,15 @@ namespace utils::hook
 		(void)initialize_min_hook();
 	}
 
-	detour::detour(const size_t place, void* target)
-		: detour(reinterpret_cast<void*>(place), target)
+	detour::detour(const size_t place, void* target, const bool use_atomic)
+		: detour(reinterpret_cast<void*>(place), target, use_atomic)
 	{
 	}
 
-	detour::detour(void* place, void* target)
+	detour::detour(void* place, void* target, const bool use_atomic)
 		: detour()
 	{
-		this->create(place, target);
+		this->create(place, target, use_atomic);
 	}
 
 	detour::~detour()
@@ -292,7 +335,14 @@ namespace utils::hook
 
 	void detour::enable()
 	{
-		MH_EnableHook(this->place_);
+		if (this->use_atomic_)
+		{
+			atomic_jump(this->place_, this->trampoline_ ? this->trampoline_ : this->target_);
+		}
+		else
+		{
+			MH_EnableHook(this->place_);
+		}
 
 		if (!this->moved_data_.empty())
 		{
@@ -303,26 +353,60 @@ namespace utils::hook
 	void detour::disable()
 	{
 		this->un_move();
-		MH_DisableHook(this->place_);
+
+		if (this->use_atomic_)
+		{
+			atomic_copy(this->place_, this->atomic_data_.data(), this->atomic_data_.size());
+		}
+		else
+		{
+			MH_DisableHook(this->place_);
+		}
 	}
 
-	void detour::create(void* place, void* target)
+	void detour::create(void* place, void* target, const bool use_atomic)
 	{
 		this->clear();
 		this->place_ = place;
+		this->target_ = target;
+		this->use_atomic_ = use_atomic;
 		store_original_data(place, 14);
 
+		if (use_atomic)
+		{
+			verify_atomic_jump(place);
+		}
+
+		// MinHook only builds the trampoline here, patching happens on enable
 		if (MH_CreateHook(this->place_, target, &this->original_) != MH_OK)
 		{
 			throw std::runtime_error(string::va("Unable to create hook at location: %p", this->place_));
 		}
 
+		if (use_atomic)
+		{
+			this->atomic_data_.resize(5);
+			memcpy(this->atomic_data_.data(), this->place_, this->atomic_data_.size());
+
+			// Written once up front, enabling only has to publish the relative jump into it
+			if (is_relatively_far(place, target))
+			{
+				this->trampoline_ = get_memory_near(place, 14);
+				if (!this->trampoline_)
+				{
+					throw std::runtime_error("Too far away to create 32bit relative branch");
+				}
+
+				jump(this->trampoline_, target, true, true);
+			}
+		}
+
 		this->enable();
 	}
 
-	void detour::create(const size_t place, void* target)
+	void detour::create(const size_t place, void* target, const bool use_atomic)
 	{
-		this->create(reinterpret_cast<void*>(place), target);
+		this->create(reinterpret_cast<void*>(place), target, use_atomic);
 	}
 
 	void detour::clear()
@@ -330,12 +414,22 @@ namespace utils::hook
 		if (this->place_)
 		{
 			this->un_move();
+
+			if (this->use_atomic_)
+			{
+				atomic_copy(this->place_, this->atomic_data_.data(), this->atomic_data_.size());
+			}
+
 			MH_RemoveHook(this->place_);
 		}
 
 		this->place_ = nullptr;
+		this->target_ = nullptr;
 		this->original_ = nullptr;
 		this->moved_data_ = {};
+		this->atomic_data_ = {};
+		this->trampoline_ = nullptr;
+		this->use_atomic_ = false;
 	}
 
 	void detour::move()
@@ -431,6 +525,77 @@ namespace utils::hook
 		return diff != int64_t(small_diff);
 	}
 
+	bool is_atomically_patchable(const void* place, const size_t length)
+	{
+		const auto address = reinterpret_cast<size_t>(place);
+		return (address & 0xF) + length <= 16;
+	}
+
+	void atomic_copy(void* place, const void* data, const size_t length)
+	{
+		if (!is_atomically_patchable(place, length))
+		{
+			throw std::runtime_error(string::va("Unable to atomically patch location: %p", place));
+		}
+
+		store_original_data(place, length);
+
+		const auto address = reinterpret_cast<size_t>(place);
+		const auto use_qword = (address & 7) + length <= 8;
+		const auto block_size = use_qword ? 8ull : 16ull;
+		const auto block = address & ~(block_size - 1);
+		const auto offset = address - block;
+
+		DWORD old_protect{};
+		VirtualProtect(reinterpret_cast<void*>(block), block_size, PAGE_EXECUTE_READWRITE, &old_protect);
+
+		if (use_qword)
+		{
+			auto* target = reinterpret_cast<volatile int64_t*>(block);
+			auto expected = *target;
+
+			while (true)
+			{
+				auto desired = expected;
+				memcpy(reinterpret_cast<uint8_t*>(&desired) + offset, data, length);
+
+				const auto current = _InterlockedCompareExchange64(target, desired, expected);
+				if (current == expected)
+				{
+					break;
+				}
+
+				expected = current;
+			}
+		}
+		else
+		{
+			auto* target = reinterpret_cast<volatile int64_t*>(block);
+
+			// Comparand gets updated with the current value on failure
+			alignas(16) int64_t expected[2]{target[0], target[1]};
+
+			while (true)
+			{
+				alignas(16) int64_t desired[2]{expected[0], expected[1]};
+				memcpy(reinterpret_cast<uint8_t*>(desired) + offset, data, length);
+
+				if (_InterlockedCompareExchange128(target, desired[1], desired[0], expected))
+				{
+					break;
+				}
+			}
+		}
+
+		VirtualProtect(reinterpret_cast<void*>(block), block_size, old_protect, &old_protect);
+		FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<void*>(block), block_size);
+	}
+
+	void atomic_copy(const size_t place, const void* data, const size_t length)
+	{
+		atomic_copy(reinterpret_cast<void*>(place), data, length);
+	}
+
 	void call(void* pointer, void* data, const bool use_ept)
 	{
 		if (is_relatively_far(pointer, data))
@@ -527,6 +692,50 @@ namespace utils::hook
 		return jump(pointer, reinterpret_cast<void*>(data), use_far, use_safe, use_ept);
 	}
 
+	void atomic_jump(void* pointer, void* data)
+	{
+		verify_atomic_jump(pointer);
+
+		// Far targets of a location always go through the same trampoline
+		static concurrency::container<std::map<const void*, uint8_t*>> trampolines{"hook::atomic_trampolines"};
+
+		trampolines.access([pointer, data](std::map<const void*, uint8_t*>& entries)
+		{
+			auto* target = data;
+			if (is_relatively_far(pointer, data))
+			{
+				auto& trampoline = entries[pointer];
+				if (!trampoline)
+				{
+					trampoline = create_atomic_trampoline(pointer, data);
+				}
+				else
+				{
+					// Threads might be inside the trampoline, so only its target address is replaced
+					atomic_copy(trampoline + atomic_trampoline_target, &data, sizeof(data));
+				}
+
+				target = trampoline;
+			}
+
+			uint8_t copy_data[5];
+			copy_data[0] = 0xE9;
+			*reinterpret_cast<int32_t*>(&copy_data[1]) = int32_t(size_t(target) - (size_t(pointer) + 5));
+
+			atomic_copy(pointer, copy_data, sizeof(copy_data));
+		});
+	}
+
+	void atomic_jump(const size_t pointer, void* data)
+	{
+		return atomic_jump(reinterpret_cast<void*>(pointer), data);
+	}
+
+	void atomic_jump(const size_t pointer, const size_t data)
+	{
+		return atomic_jump(pointer, reinterpret_cast<void*>(data));
+	}
+
 	void* assemble(const std::function<void(assembler&)>& asm_function)
 	{
 		static asmjit::JitRuntime runtime;
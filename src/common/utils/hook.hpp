@@ -86,8 +86,8 @@ namespace utils::hook
 	{
 	public:
 		detour();
-		detour(void* place, void* target);
-		detour(size_t place, void* target);
+		detour(void* place, void* target, bool use_atomic = false);
+		detour(size_t place, void* target, bool use_atomic = false);
 		~detour();
 
 		detour(detour&& other) noexcept
@@ -102,12 +102,20 @@ namespace utils::hook
 				this->clear();
 
 				this->place_ = other.place_;
+				this->target_ = other.target_;
 				this->original_ = other.original_;
 				this->moved_data_ = other.moved_data_;
+				this->atomic_data_ = other.atomic_data_;
+				this->trampoline_ = other.trampoline_;
+				this->use_atomic_ = other.use_atomic_;
 
 				other.place_ = nullptr;
+				other.target_ = nullptr;
 				other.original_ = nullptr;
 				other.moved_data_ = {};
+				other.atomic_data_ = {};
+				other.trampoline_ = nullptr;
+				other.use_atomic_ = false;
 			}
 
 			return *this;
@@ -119,8 +127,12 @@ namespace utils::hook
 		void enable();
 		void disable();
 
-		void create(void* place, void* target);
-		void create(size_t place, void* target);
+		// Atomic detours don't let MinHook suspend all threads while patching.
+		// The branch is published through a single interlocked write instead,
+		// so they can be toggled at runtime without stalling the process.
+		// This requires the first instruction at place to span the whole 5 byte jump.
+		void create(void* place, void* target, bool use_atomic = false);
+		void create(size_t place, void* target, bool use_atomic = false);
 		void clear();
 
 		void move();
@@ -141,8 +153,12 @@ namespace utils::hook
 
 	private:
 		std::vector<uint8_t> moved_data_{};
+		std::vector<uint8_t> atomic_data_{};
+		void* trampoline_{};
 		void* place_{};
+		void* target_{};
 		void* original_{};
+		bool use_atomic_{false};
 
 		void un_move();
 	};
@@ -157,6 +173,11 @@ namespace utils::hook
 
 	bool is_relatively_far(const void* pointer, const void* data, int offset = 5);
 
+	// Patches that fit into one aligned 8 or 16 byte block can be written atomically
+	bool is_atomically_patchable(const void* place, size_t length);
+	void atomic_copy(void* place, const void* data, size_t length);
+	void atomic_copy(size_t place, const void* data, size_t length);
+
 	void call(void* pointer, void* data, bool use_ept = false);
 	void call(size_t pointer, void* data, bool use_ept = false);
 	void call(size_t pointer, size_t data, bool use_ept = false);
@@ -165,6 +186,14 @@ namespace utils::hook
 	void jump(size_t pointer, void* data, bool use_far = false, bool use_safe = false, bool use_ept = false);
 	void jump(size_t pointer, size_t data, bool use_far = false, bool use_safe = false, bool use_ept = false);
 
+	// Writes a 5 byte relative jump with a single interlocked write.
+	// Fails unless the first instruction at pointer covers all 5 bytes,
+	// otherwise a thread could resume in the middle of the new jump.
+	// Far targets go through a trampoline that is created once per location and retargeted atomically.
+	void atomic_jump(void* pointer, void* data);
+	void atomic_jump(size_t pointer, void* data);
+	void atomic_jump(size_t pointer, size_t data);
+
 	void* assemble(const std::function<void(assembler&)>& asm_function);
 
 	void inject(void* pointer, const void* data);
@@ -1,65 +1,539 @@
 #include "info_string.hpp"
 #include "string.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+
 namespace utils
 {
 	info_string::info_string(const std::string& buffer)
+		: info_string(std::string_view{buffer})
 	{
-		this->parse(buffer);
 	}
 
 	info_string::info_string(const std::string_view& buffer)
-		: info_string(std::string{buffer})
 	{
+		this->parse(buffer);
+	}
+
+	void info_string::set(const std::string_view& key, const std::string_view& value)
+	{
+		if (this->store(key, value, this->version_ + 1))
+		{
+			++this->version_;
+		}
 	}
 
-	void info_string::set(const std::string& key, const std::string& value)
+	void info_string::remove(const std::string_view& key)
 	{
-		this->key_value_pairs_[key] = value;
+		if (this->erase(key, this->version_ + 1))
+		{
+			++this->version_;
+		}
 	}
 
-	std::string info_string::get(const std::string& key) const
+	void info_string::clear()
 	{
-		const auto value = this->key_value_pairs_.find(key);
-		if (value != this->key_value_pairs_.end())
+		if (this->entries_.empty())
 		{
-			return value->second;
+			return;
 		}
 
-		return "";
+		this->reset(++this->version_);
 	}
 
-	void info_string::parse(std::string buffer)
+	void info_string::assign(const info_string& other)
 	{
-		if (buffer[0] == '\\')
+		const auto version = this->version_ + 1;
+		auto changed = false;
+
+		for (size_t i = this->entries_.size(); i > 0; --i)
+		{
+			const auto key = std::string{this->get_key(this->entries_[i - 1])};
+			if (other.find(key) == std::string_view::npos)
+			{
+				changed |= this->erase(key, version);
+			}
+		}
+
+		for (const auto& entry : other.entries_)
+		{
+			changed |= this->store(other.get_key(entry), other.get_value(entry), version);
+		}
+
+		if (changed)
 		{
-			buffer = buffer.substr(1);
+			this->version_ = version;
 		}
+	}
 
-		auto key_values = string::split(buffer, '\\');
-		for (size_t i = 0; !key_values.empty() && i < (key_values.size() - 1); i += 2)
+	std::string info_string::get(const std::string_view& key) const
+	{
+		return std::string{this->get_view(key)};
+	}
+
+	std::string_view info_string::get_view(const std::string_view& key) const
+	{
+		const auto index = this->find(key);
+		if (index != std::string_view::npos)
 		{
-			const auto& key = key_values[i];
-			const auto& value = key_values[i + 1];
-			this->key_value_pairs_[key] = value;
+			return this->get_value(this->entries_[index]);
 		}
+
+		return {};
 	}
 
 	std::string info_string::build() const
 	{
-		//auto first = true;
 		std::string info_string;
-		for (auto i = this->key_value_pairs_.begin(); i != this->key_value_pairs_.end(); ++i)
+		this->build(info_string);
+		return info_string;
+	}
+
+	void info_string::build(std::string& output) const
+	{
+		size_t length = 0;
+		for (const auto& entry : this->entries_)
+		{
+			length += 2 + entry.key_length + entry.value_length;
+		}
+
+		output.resize(length);
+
+		auto* current = output.data();
+		for (const auto& entry : this->entries_)
 		{
-			//if (first) first = false;
-			/*else*/
-			info_string.append("\\");
+			*current++ = '\\';
+			std::memcpy(current, this->buffer_.data() + entry.key_offset, entry.key_length);
+			current += entry.key_length;
 
-			info_string.append(i->first); // Key
-			info_string.append("\\");
-			info_string.append(i->second); // Value
+			*current++ = '\\';
+			std::memcpy(current, this->buffer_.data() + entry.value_offset, entry.value_length);
+			current += entry.value_length;
 		}
+	}
 
-		return info_string;
+	size_t info_string::size() const
+	{
+		return this->entries_.size();
+	}
+
+	bool info_string::empty() const
+	{
+		return this->entries_.empty();
+	}
+
+	uint64_t info_string::get_version() const
+	{
+		return this->version_;
+	}
+
+	void info_string::build_delta(const uint64_t since_version, std::string& output) const
+	{
+		output.clear();
+
+		if (since_version == this->version_)
+		{
+			return;
+		}
+
+		// Removals older than the kept history can't be reproduced anymore.
+		// A version from the future belongs to a previous incarnation of this info string.
+		const auto full_snapshot = since_version == 0 || since_version < this->history_start_
+			|| since_version > this->version_;
+		const auto base_version = full_snapshot ? 0 : since_version;
+
+		output.append("\\");
+		output.append(std::to_string(base_version));
+		output.append("\\");
+		output.append(std::to_string(this->version_));
+
+		if (!full_snapshot)
+		{
+			for (const auto& removed : this->removed_keys_)
+			{
+				if (removed.version > since_version)
+				{
+					output.append("\\-\\");
+					output.append(removed.key);
+				}
+			}
+		}
+
+		for (const auto& entry : this->entries_)
+		{
+			if (full_snapshot || entry.version > since_version)
+			{
+				output.append("\\+\\");
+				output.append(this->get_key(entry));
+				output.push_back('\\');
+				output.append(this->get_value(entry));
+			}
+		}
+	}
+
+	bool info_string::apply_delta(const std::string_view& delta)
+	{
+		struct operation
+		{
+			bool remove;
+			std::string_view key;
+			std::string_view value;
+		};
+
+		auto data = delta;
+		if (!data.empty() && data[0] == '\\')
+		{
+			data.remove_prefix(1);
+		}
+
+		const string::split_view tokens(data, '\\');
+		auto token = tokens.begin();
+
+		const auto read_version = [&](uint64_t& version)
+		{
+			if (token == tokens.end())
+			{
+				return false;
+			}
+
+			const auto text = *token++;
+			const auto result = std::from_chars(text.data(), text.data() + text.size(), version);
+			return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+		};
+
+		uint64_t base_version{};
+		uint64_t new_version{};
+		// Only a full snapshot may go back to version 0, which is an empty info string
+		if (!read_version(base_version) || !read_version(new_version)
+			|| (base_version != 0 && new_version <= base_version))
+		{
+			return false;
+		}
+
+		if (base_version != 0 && base_version != this->version_)
+		{
+			return false;
+		}
+
+		std::vector<operation> operations{};
+		while (token != tokens.end())
+		{
+			const auto type = *token++;
+			if ((type != "+" && type != "-") || token == tokens.end())
+			{
+				return false;
+			}
+
+			operation op{};
+			op.remove = type == "-";
+			op.key = *token++;
+
+			if (!op.remove)
+			{
+				// The tokenizer drops a trailing empty value
+				if (token != tokens.end())
+				{
+					op.value = *token++;
+				}
+				else if (op.key.data() + op.key.size() == data.data() + data.size())
+				{
+					return false;
+				}
+			}
+
+			operations.emplace_back(op);
+		}
+
+		if (base_version == 0)
+		{
+			this->reset(new_version);
+		}
+
+		for (const auto& op : operations)
+		{
+			if (op.remove)
+			{
+				this->erase(op.key, new_version);
+			}
+			else
+			{
+				this->store(op.key, op.value, new_version);
+			}
+		}
+
+		this->version_ = new_version;
+		return true;
+	}
+
+	bool info_string::store(const std::string_view& key, const std::string_view& value, const uint64_t version)
+	{
+		// Appending might move the buffer, so views into it need to be copied first
+		if (this->is_in_buffer(key) || this->is_in_buffer(value))
+		{
+			return this->store(std::string{key}, std::string{value}, version);
+		}
+
+		const auto index = this->find(key);
+		if (index != std::string_view::npos)
+		{
+			auto& existing = this->entries_[index];
+			if (this->get_value(existing) == value)
+			{
+				return false;
+			}
+
+			if (value.size() <= existing.value_length)
+			{
+				std::copy(value.begin(), value.end(), this->buffer_.begin() + existing.value_offset);
+				this->unused_bytes_ += existing.value_length - value.size();
+				existing.value_length = static_cast<uint32_t>(value.size());
+			}
+			else
+			{
+				this->unused_bytes_ += existing.value_length;
+				existing.value_offset = this->append(value);
+				existing.value_length = static_cast<uint32_t>(value.size());
+			}
+
+			existing.version = version;
+
+			if (this->unused_bytes_ > 256 && this->unused_bytes_ > this->buffer_.size() / 2)
+			{
+				this->compact();
+			}
+
+			return true;
+		}
+
+		this->forget_removal(key);
+
+		entry new_entry{};
+		new_entry.key_offset = this->append(key);
+		new_entry.key_length = static_cast<uint32_t>(key.size());
+		new_entry.value_offset = this->append(value);
+		new_entry.value_length = static_cast<uint32_t>(value.size());
+		new_entry.version = version;
+
+		this->add(new_entry);
+		return true;
+	}
+
+	bool info_string::erase(const std::string_view& key, const uint64_t version)
+	{
+		const auto index = this->find(key);
+		if (index == std::string_view::npos)
+		{
+			return false;
+		}
+
+		const auto& existing = this->entries_[index];
+		this->removed_keys_.push_back({std::string{key}, version});
+		this->unused_bytes_ += existing.key_length + existing.value_length;
+
+		this->entries_.erase(this->entries_.begin() + static_cast<ptrdiff_t>(index));
+
+		if (this->entries_.size() > index_threshold)
+		{
+			this->rebuild_index();
+		}
+		else
+		{
+			this->index_.clear();
+		}
+
+		// Deltas from before the oldest forgotten removal need a full snapshot
+		if (this->removed_keys_.size() > max_removed_keys)
+		{
+			this->history_start_ = std::max(this->history_start_, this->removed_keys_.front().version);
+			this->removed_keys_.erase(this->removed_keys_.begin());
+		}
+
+		return true;
+	}
+
+	void info_string::reset(const uint64_t version)
+	{
+		this->buffer_.clear();
+		this->entries_.clear();
+		this->index_.clear();
+		this->removed_keys_.clear();
+		this->unused_bytes_ = 0;
+		this->history_start_ = version;
+	}
+
+	void info_string::forget_removal(const std::string_view& key)
+	{
+		std::erase_if(this->removed_keys_, [&key](const removed_key& removed)
+		{
+			return removed.key == key;
+		});
+	}
+
+	void info_string::parse(std::string_view buffer)
+	{
+		if (!buffer.empty() && buffer[0] == '\\')
+		{
+			buffer.remove_prefix(1);
+		}
+
+		this->buffer_.assign(buffer);
+		this->entries_.clear();
+		this->index_.clear();
+		this->unused_bytes_ = 0;
+
+		const string::split_view key_values(this->buffer_, '\\');
+		for (auto i = key_values.begin(); i != key_values.end();)
+		{
+			const auto key = *i++;
+
+			// The tokenizer drops a trailing empty token, which is an empty value here
+			const auto* key_end = key.data() + key.size();
+			if (i == key_values.end() && key_end == this->buffer_.data() + this->buffer_.size())
+			{
+				break;
+			}
+
+			const auto value = i != key_values.end() ? *i++ : std::string_view{key_end + 1, 0};
+
+			entry new_entry{};
+			new_entry.key_offset = static_cast<uint32_t>(key.data() - this->buffer_.data());
+			new_entry.key_length = static_cast<uint32_t>(key.size());
+			new_entry.value_offset = static_cast<uint32_t>(value.data() - this->buffer_.data());
+			new_entry.value_length = static_cast<uint32_t>(value.size());
+
+			// Later duplicates win
+			const auto index = this->find(key);
+			if (index != std::string_view::npos)
+			{
+				this->unused_bytes_ += this->entries_[index].key_length + this->entries_[index].value_length;
+				this->entries_[index] = new_entry;
+			}
+			else
+			{
+				this->add(new_entry);
+			}
+		}
+	}
+
+	std::string_view info_string::get_key(const entry& entry) const
+	{
+		return {this->buffer_.data() + entry.key_offset, entry.key_length};
+	}
+
+	std::string_view info_string::get_value(const entry& entry) const
+	{
+		return {this->buffer_.data() + entry.value_offset, entry.value_length};
+	}
+
+	size_t info_string::find(const std::string_view& key) const
+	{
+		if (this->index_.empty())
+		{
+			for (size_t i = 0; i < this->entries_.size(); ++i)
+			{
+				if (this->get_key(this->entries_[i]) == key)
+				{
+					return i;
+				}
+			}
+
+			return std::string_view::npos;
+		}
+
+		const auto mask = this->index_.size() - 1;
+		for (auto slot = std::hash<std::string_view>{}(key) & mask;; slot = (slot + 1) & mask)
+		{
+			const auto index = this->index_[slot];
+			if (!index)
+			{
+				return std::string_view::npos;
+			}
+
+			if (this->get_key(this->entries_[index - 1]) == key)
+			{
+				return index - 1;
+			}
+		}
+	}
+
+	void info_string::add(const entry& entry)
+	{
+		this->entries_.push_back(entry);
+
+		if (this->entries_.size() <= index_threshold)
+		{
+			return;
+		}
+
+		// Keep the table at most half full
+		if (this->entries_.size() * 2 > this->index_.size())
+		{
+			this->rebuild_index();
+			return;
+		}
+
+		const auto mask = this->index_.size() - 1;
+		auto slot = std::hash<std::string_view>{}(this->get_key(entry)) & mask;
+		while (this->index_[slot])
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		this->index_[slot] = static_cast<uint32_t>(this->entries_.size());
+	}
+
+	uint32_t info_string::append(const std::string_view& data)
+	{
+		const auto offset = static_cast<uint32_t>(this->buffer_.size());
+		this->buffer_.append(data);
+		return offset;
+	}
+
+	bool info_string::is_in_buffer(const std::string_view& data) const
+	{
+		const auto* begin = this->buffer_.data();
+		const auto* end = begin + this->buffer_.size();
+		return !data.empty() && data.data() >= begin && data.data() < end;
+	}
+
+	void info_string::rebuild_index()
+	{
+		this->index_.assign(std::bit_ceil(this->entries_.size() * 4), 0);
+
+		const auto mask = this->index_.size() - 1;
+		for (size_t i = 0; i < this->entries_.size(); ++i)
+		{
+			auto slot = std::hash<std::string_view>{}(this->get_key(this->entries_[i])) & mask;
+			while (this->index_[slot])
+			{
+				slot = (slot + 1) & mask;
+			}
+
+			this->index_[slot] = static_cast<uint32_t>(i + 1);
+		}
+	}
+
+	void info_string::compact()
+	{
+		std::string buffer{};
+		buffer.reserve(this->buffer_.size() - this->unused_bytes_);
+
+		for (auto& entry : this->entries_)
+		{
+			const auto key_offset = static_cast<uint32_t>(buffer.size());
+			buffer.append(this->get_key(entry));
+
+			const auto value_offset = static_cast<uint32_t>(buffer.size());
+			buffer.append(this->get_value(entry));
+
+			entry.key_offset = key_offset;
+			entry.value_offset = value_offset;
+		}
+
+		this->buffer_ = std::move(buffer);
+		this->unused_bytes_ = 0;
 	}
 }
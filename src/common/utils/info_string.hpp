@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 namespace utils
 {
+	// Keys and values live in one owned buffer and are referenced by offset.
+	// Small strings are searched linearly, larger ones get an open addressing index.
+	// Every modification bumps the version, so changes can be shipped as deltas.
 	class info_string
 	{
 	public:
@@ -12,13 +17,79 @@ namespace utils
 		info_string(const std::string& buffer);
 		info_string(const std::string_view& buffer);
 
-		void set(const std::string& key, const std::string& value);
-		std::string get(const std::string& key) const;
+		void set(const std::string_view& key, const std::string_view& value);
+		void remove(const std::string_view& key);
+		void clear();
+
+		// Takes over the contents of another info string, only keys that actually change are versioned
+		void assign(const info_string& other);
+
+		std::string get(const std::string_view& key) const;
+
+		// Stays valid until the info string is modified
+		std::string_view get_view(const std::string_view& key) const;
+
 		std::string build() const;
+		void build(std::string& output) const;
+
+		size_t size() const;
+		bool empty() const;
+
+		uint64_t get_version() const;
+
+		// Delta layout: \base\version followed by \+\key\value for set keys and \-\key for removed ones.
+		// A base of 0 is a full snapshot that replaces everything, it is also sent when the given version is ahead.
+		// Empty if nothing changed since the given version.
+		void build_delta(uint64_t since_version, std::string& output) const;
+
+		// Fails without modifying anything if the delta is malformed or doesn't start at this version
+		bool apply_delta(const std::string_view& delta);
 
 	private:
-		std::unordered_map<std::string, std::string> key_value_pairs_{};
+		struct entry
+		{
+			uint32_t key_offset;
+			uint32_t key_length;
+			uint32_t value_offset;
+			uint32_t value_length;
+			uint64_t version;
+		};
+
+		struct removed_key
+		{
+			std::string key;
+			uint64_t version;
+		};
+
+		static constexpr size_t index_threshold = 16;
+		static constexpr size_t max_removed_keys = 64;
+
+		std::string buffer_{};
+		std::vector<entry> entries_{};
+		std::vector<uint32_t> index_{};
+		size_t unused_bytes_{};
+
+		uint64_t version_{};
+		uint64_t history_start_{};
+		std::vector<removed_key> removed_keys_{};
+
+		bool store(const std::string_view& key, const std::string_view& value, uint64_t version);
+		bool erase(const std::string_view& key, uint64_t version);
+		void reset(uint64_t version);
+		void forget_removal(const std::string_view& key);
+
+		void parse(std::string_view buffer);
+
+		std::string_view get_key(const entry& entry) const;
+		std::string_view get_value(const entry& entry) const;
+
+		size_t find(const std::string_view& key) const;
+		void add(const entry& entry);
+
+		uint32_t append(const std::string_view& data);
+		bool is_in_buffer(const std::string_view& data) const;
 
-		void parse(std::string buffer);
+		void rebuild_index();
+		void compact();
 	};
 }
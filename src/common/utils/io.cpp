@@ -127,4 +127,78 @@ namespace utils::io
 		                      std::filesystem::copy_options::overwrite_existing |
 		                      std::filesystem::copy_options::recursive);
 	}
+
+	mapped_file::mapped_file(const std::string& file)
+	{
+		const nt::handle<INVALID_HANDLE_VALUE> file_handle = CreateFileA(file.data(), GENERIC_READ, FILE_SHARE_READ,
+		                                                                 nullptr, OPEN_EXISTING,
+		                                                                 FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!file_handle)
+		{
+			return;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file_handle, &size) || size.QuadPart <= 0)
+		{
+			return;
+		}
+
+		// The view keeps the mapping alive, both handles can be closed right away
+		const nt::handle<> mapping = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			return;
+		}
+
+		this->data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (this->data_)
+		{
+			this->size_ = static_cast<size_t>(size.QuadPart);
+		}
+	}
+
+	mapped_file::~mapped_file()
+	{
+		this->unmap();
+	}
+
+	mapped_file::mapped_file(mapped_file&& obj) noexcept
+	{
+		this->operator=(std::move(obj));
+	}
+
+	mapped_file& mapped_file::operator=(mapped_file&& obj) noexcept
+	{
+		if (this != &obj)
+		{
+			this->unmap();
+			this->data_ = obj.data_;
+			this->size_ = obj.size_;
+			obj.data_ = nullptr;
+			obj.size_ = 0;
+		}
+
+		return *this;
+	}
+
+	bool mapped_file::is_valid() const
+	{
+		return this->data_ != nullptr;
+	}
+
+	std::string_view mapped_file::get_data() const
+	{
+		return {this->data_, this->size_};
+	}
+
+	void mapped_file::unmap()
+	{
+		if (this->data_)
+		{
+			UnmapViewOfFile(this->data_);
+			this->data_ = nullptr;
+			this->size_ = 0;
+		}
+	}
 }
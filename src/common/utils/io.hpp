@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
 
@@ -18,4 +19,28 @@ namespace utils::io
 	bool directory_is_empty(const std::string& directory);
 	std::vector<std::string> list_files(const std::string& directory);
 	void copy_folder(const std::filesystem::path& src, const std::filesystem::path& target);
+
+	// Read-only view of a whole file, empty files can't be mapped
+	class mapped_file
+	{
+	public:
+		mapped_file() = default;
+		explicit mapped_file(const std::string& file);
+		~mapped_file();
+
+		mapped_file(mapped_file&& obj) noexcept;
+		mapped_file& operator=(mapped_file&& obj) noexcept;
+
+		mapped_file(const mapped_file&) = delete;
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		bool is_valid() const;
+		std::string_view get_data() const;
+
+	private:
+		const char* data_{};
+		size_t size_{};
+
+		void unmap();
+	};
 }
@@ -1,36 +1,363 @@
 #include "memory.hpp"
 #include "nt.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace utils
 {
 	memory::allocator memory::mem_allocator_;
 
-	memory::allocator::~allocator()
+	namespace
+	{
+		// Blocks up to 1 KiB are rounded up to a power of two and recycled per thread
+		constexpr size_t min_block_shift = 4;
+		constexpr uint32_t block_class_count = 7;
+		constexpr size_t block_cache_depth = 32;
+		constexpr uint32_t large_block = ~0u;
+
+		uint32_t get_block_class(const size_t length)
+		{
+			uint32_t block_class = 0;
+			while (block_class < block_class_count && (size_t(1) << (block_class + min_block_shift)) < length)
+			{
+				++block_class;
+			}
+
+			return block_class < block_class_count ? block_class : large_block;
+		}
+
+		size_t get_block_size(const uint32_t block_class, const size_t length)
+		{
+			return block_class == large_block ? length : size_t(1) << (block_class + min_block_shift);
+		}
+
+		// Trivially destructible, so it can still be accessed while other thread-locals are being destroyed
+		struct block_cache
+		{
+			void* blocks[block_class_count][block_cache_depth];
+			size_t counts[block_class_count];
+			bool released;
+		};
+
+		thread_local block_cache cache{};
+
+		struct block_cache_releaser
+		{
+			~block_cache_releaser()
+			{
+				for (uint32_t i = 0; i < block_class_count; ++i)
+				{
+					while (cache.counts[i])
+					{
+						::free(cache.blocks[i][--cache.counts[i]]);
+					}
+				}
+
+				cache.released = true;
+			}
+		};
+
+		void* pop_cached_block(const uint32_t block_class)
+		{
+			if (block_class == large_block || !cache.counts[block_class])
+			{
+				return nullptr;
+			}
+
+			return cache.blocks[block_class][--cache.counts[block_class]];
+		}
+
+		bool push_cached_block(void* block, const uint32_t block_class)
+		{
+			thread_local block_cache_releaser releaser{};
+
+			if (block_class == large_block || cache.released || cache.counts[block_class] >= block_cache_depth)
+			{
+				return false;
+			}
+
+			cache.blocks[block_class][cache.counts[block_class]++] = block;
+			return true;
+		}
+
+		size_t get_shard_index()
+		{
+			static std::atomic<size_t> next_index{};
+			thread_local const size_t index = next_index++;
+			return index;
+		}
+
+		// Foreign pointers might not have readable memory in front of them, faulting just means it isn't ours
+		bool read_cookie(const uintptr_t* cookie, uintptr_t& value)
+		{
+			__try
+			{
+				value = *cookie;
+				return true;
+			}
+			__except (GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION
+				          ? EXCEPTION_EXECUTE_HANDLER
+				          : EXCEPTION_CONTINUE_SEARCH)
+			{
+				return false;
+			}
+		}
+	}
+
+	struct memory::allocator::block_header
+	{
+		uintptr_t cookie;
+		block_header* prev;
+		block_header* next;
+		uint32_t shard;
+		uint32_t block_class;
+	};
+
+	struct memory::arena::page
+	{
+		page* next;
+		size_t size;
+		size_t used;
+	};
+
+	memory::arena::arena(const size_t page_size)
+		: page_size_(std::max<size_t>(page_size, 256))
+	{
+	}
+
+	memory::arena::~arena()
+	{
+		this->release();
+	}
+
+	memory::arena::arena(arena&& obj) noexcept
+	{
+		this->operator=(std::move(obj));
+	}
+
+	memory::arena& memory::arena::operator=(arena&& obj) noexcept
+	{
+		if (this != &obj)
+		{
+			this->release();
+
+			this->page_size_ = obj.page_size_;
+			this->pages_ = obj.pages_;
+			this->spare_ = obj.spare_;
+
+			obj.pages_ = nullptr;
+			obj.spare_ = nullptr;
+		}
+
+		return *this;
+	}
+
+	void memory::arena::release()
 	{
 		this->clear();
+
+		::free(this->spare_);
+		this->spare_ = nullptr;
 	}
 
-	void memory::allocator::clear()
+	void memory::arena::clear()
 	{
-		std::lock_guard _(this->mutex_);
+		auto* current = this->pages_;
+		this->pages_ = nullptr;
+
+		while (current)
+		{
+			auto* next = current->next;
+
+			// Keep one regular page around, so the next cycle doesn't hit the heap again
+			if (!this->spare_ && current->size == this->page_size_)
+			{
+				current->next = nullptr;
+				current->used = 0;
+				this->spare_ = current;
+			}
+			else
+			{
+				::free(current);
+			}
+
+			current = next;
+		}
+	}
+
+	void* memory::arena::allocate(const size_t length, const size_t alignment)
+	{
+		const auto carve = [length, alignment](page* target) -> void*
+		{
+			const auto base = reinterpret_cast<uintptr_t>(target + 1);
+			const auto offset = ((base + target->used + alignment - 1) & ~(alignment - 1)) - base;
+			if (offset > target->size || length > target->size - offset)
+			{
+				return nullptr;
+			}
+
+			target->used = offset + length;
+
+			auto* data = reinterpret_cast<void*>(base + offset);
+			std::memset(data, 0, length);
+			return data;
+		};
+
+		auto* current = this->pages_;
+		if (current)
+		{
+			if (auto* data = carve(current))
+			{
+				return data;
+			}
+		}
+
+		const auto required = length + alignment;
+
+		page* new_page{};
+		if (this->spare_ && required <= this->spare_->size)
+		{
+			new_page = this->spare_;
+			this->spare_ = nullptr;
+		}
+		else
+		{
+			const auto size = std::max(this->page_size_, required);
+			new_page = static_cast<page*>(malloc(sizeof(page) + size));
+			if (!new_page)
+			{
+				return nullptr;
+			}
+
+			new_page->size = size;
+		}
+
+		new_page->used = 0;
+
+		// Oversized allocations get their own page behind the current one,
+		// so the space left in the current page can still be used
+		if (current && required > this->page_size_)
+		{
+			new_page->next = current->next;
+			current->next = new_page;
+		}
+		else
+		{
+			new_page->next = current;
+			this->pages_ = new_page;
+		}
+
+		return carve(new_page);
+	}
 
-		for (auto& data : this->pool_)
+	char* memory::arena::duplicate_string(const std::string& string)
+	{
+		const auto new_string = this->allocate_array<char>(string.size() + 1);
+		if (new_string)
 		{
-			memory::free(data);
+			std::memcpy(new_string, string.data(), string.size());
 		}
 
-		this->pool_.clear();
+		return new_string;
+	}
+
+	bool memory::arena::empty() const
+	{
+		return !this->pages_;
+	}
+
+	memory::allocator::~allocator()
+	{
+		this->clear();
+	}
+
+	uintptr_t memory::allocator::get_cookie(const block_header* header) const
+	{
+		constexpr auto block_magic = static_cast<uintptr_t>(0x4D656D426C6F636Bull);
+		return reinterpret_cast<uintptr_t>(this) ^ reinterpret_cast<uintptr_t>(header) ^ block_magic;
+	}
+
+	bool memory::allocator::is_owned(const block_header* header) const
+	{
+		uintptr_t cookie{};
+		return read_cookie(&header->cookie, cookie) && cookie == this->get_cookie(header);
+	}
+
+	void memory::allocator::clear()
+	{
+		for (auto& shard : this->shards_)
+		{
+			block_header* blocks{};
+
+			{
+				std::lock_guard _(shard.mutex);
+				blocks = shard.blocks;
+				shard.blocks = nullptr;
+				shard.count = 0;
+
+				// Stale pointers must not match once the memory is gone
+				for (auto* block = blocks; block; block = block->next)
+				{
+					block->cookie = 0;
+				}
+			}
+
+			while (blocks)
+			{
+				auto* next = blocks->next;
+				::free(blocks);
+				blocks = next;
+			}
+		}
 	}
 
 	void memory::allocator::free(void* data)
 	{
-		std::lock_guard _(this->mutex_);
+		if (!data)
+		{
+			return;
+		}
+
+		auto* header = static_cast<block_header*>(data) - 1;
+		if (!this->is_owned(header))
+		{
+			return;
+		}
+
+		const auto shard_index = header->shard;
+		auto& shard = this->shards_[shard_index];
 
-		const auto j = std::find(this->pool_.begin(), this->pool_.end(), data);
-		if (j != this->pool_.end())
 		{
-			memory::free(data);
-			this->pool_.erase(j);
+			std::lock_guard _(shard.mutex);
+
+			// A concurrent free or clear of the same block might have won the race
+			if (!this->is_owned(header) || header->shard != shard_index)
+			{
+				return;
+			}
+
+			if (header->prev)
+			{
+				header->prev->next = header->next;
+			}
+			else
+			{
+				shard.blocks = header->next;
+			}
+
+			if (header->next)
+			{
+				header->next->prev = header->prev;
+			}
+
+			header->cookie = 0;
+			--shard.count;
+		}
+
+		if (!push_cached_block(header, header->block_class))
+		{
+			::free(header);
 		}
 	}
 
@@ -41,33 +368,79 @@ namespace utils
 
 	void* memory::allocator::allocate(const size_t length)
 	{
-		std::lock_guard _(this->mutex_);
+		static_assert(sizeof(block_header) % alignof(std::max_align_t) == 0);
+
+		const auto block_class = get_block_class(length);
+
+		auto* header = static_cast<block_header*>(pop_cached_block(block_class));
+		if (!header)
+		{
+			header = static_cast<block_header*>(malloc(sizeof(block_header) + get_block_size(block_class, length)));
+			if (!header)
+			{
+				return nullptr;
+			}
+		}
+
+		auto* data = header + 1;
+		std::memset(data, 0, length);
+
+		const auto shard_index = static_cast<uint32_t>(get_shard_index() % shard_count);
+		auto& shard = this->shards_[shard_index];
+
+		header->cookie = this->get_cookie(header);
+		header->shard = shard_index;
+		header->block_class = block_class;
+		header->prev = nullptr;
+
+		{
+			std::lock_guard _(shard.mutex);
+
+			header->next = shard.blocks;
+			if (shard.blocks)
+			{
+				shard.blocks->prev = header;
+			}
+
+			shard.blocks = header;
+			++shard.count;
+		}
 
-		const auto data = memory::allocate(length);
-		this->pool_.push_back(data);
 		return data;
 	}
 
 	bool memory::allocator::empty() const
 	{
-		return this->pool_.empty();
+		for (const auto& shard : this->shards_)
+		{
+			if (shard.count)
+			{
+				return false;
+			}
+		}
+
+		return true;
 	}
 
 	char* memory::allocator::duplicate_string(const std::string& string)
 	{
-		std::lock_guard _(this->mutex_);
+		const auto new_string = this->allocate_array<char>(string.size() + 1);
+		if (new_string)
+		{
+			std::memcpy(new_string, string.data(), string.size());
+		}
 
-		const auto data = memory::duplicate_string(string);
-		this->pool_.push_back(data);
-		return data;
+		return new_string;
 	}
 
 	bool memory::allocator::find(const void* data)
 	{
-		std::lock_guard _(this->mutex_);
+		if (!data)
+		{
+			return false;
+		}
 
-		const auto j = std::find(this->pool_.begin(), this->pool_.end(), data);
-		return j != this->pool_.end();
+		return this->is_owned(static_cast<const block_header*>(data) - 1);
 	}
 
 	void* memory::allocate(const size_t length)
@@ -170,4 +543,10 @@ namespace utils
 	{
 		return &memory::mem_allocator_;
 	}
+
+	memory::arena& memory::get_thread_arena()
+	{
+		thread_local arena thread_arena{};
+		return thread_arena;
+	}
 }
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace utils
@@ -8,11 +12,65 @@ namespace utils
 	class memory final
 	{
 	public:
+		// Bump allocator that hands out zeroed memory from chunked pages.
+		// Single allocations can't be freed, clear releases everything at once.
+		// Not synchronized, use one arena per thread or get_thread_arena.
+		class arena final
+		{
+		public:
+			static constexpr size_t default_page_size = 64 * 1024;
+
+			arena(size_t page_size = default_page_size);
+			~arena();
+
+			arena(arena&& obj) noexcept;
+			arena& operator=(arena&& obj) noexcept;
+
+			arena(const arena&) = delete;
+			arena& operator=(const arena&) = delete;
+
+			void clear();
+
+			void* allocate(size_t length, size_t alignment = alignof(std::max_align_t));
+
+			template <typename T>
+			inline T* allocate()
+			{
+				return this->allocate_array<T>(1);
+			}
+
+			template <typename T>
+			inline T* allocate_array(const size_t count = 1)
+			{
+				return static_cast<T*>(this->allocate(count * sizeof(T), alignof(T)));
+			}
+
+			char* duplicate_string(const std::string& string);
+
+			bool empty() const;
+
+		private:
+			struct page;
+
+			size_t page_size_{};
+			page* pages_{};
+			page* spare_{};
+
+			void release();
+		};
+
+		// Tracks every allocation through a block header, so free and find are O(1).
+		// Allocations are spread across shards picked per thread and small blocks are
+		// recycled through a thread-local cache, threads don't share a single lock.
 		class allocator final
 		{
 		public:
+			allocator() = default;
 			~allocator();
 
+			allocator(const allocator&) = delete;
+			allocator& operator=(const allocator&) = delete;
+
 			void clear();
 
 			void free(void* data);
@@ -40,8 +98,21 @@ namespace utils
 			bool find(const void* data);
 
 		private:
-			std::mutex mutex_;
-			std::vector<void*> pool_;
+			struct block_header;
+
+			struct shard
+			{
+				std::mutex mutex{};
+				block_header* blocks{};
+				std::atomic<size_t> count{};
+			};
+
+			static constexpr size_t shard_count = 8;
+			shard shards_[shard_count]{};
+
+			// The cookie ties a header to its allocator and address, foreign pointers are ignored
+			uintptr_t get_cookie(const block_header* header) const;
+			bool is_owned(const block_header* header) const;
 		};
 
 		static void* allocate(size_t length);
@@ -70,6 +141,7 @@ namespace utils
 		static bool is_rdata_ptr(void* ptr);
 
 		static allocator* get_allocator();
+		static arena& get_thread_arena();
 
 	private:
 		static allocator mem_allocator_;
@@ -2,56 +2,264 @@
 #include <sstream>
 #include <cstdarg>
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <emmintrin.h>
 
 #include "nt.hpp"
 
 namespace utils::string
 {
-	const char* va(const char* fmt, ...)
+	va_provider<8, 256>& get_va_provider()
 	{
 		static thread_local va_provider<8, 256> provider;
+		return provider;
+	}
 
+	const char* va(const char* fmt, ...)
+	{
 		va_list ap;
 		va_start(ap, fmt);
 
-		const char* result = provider.get(fmt, ap);
+		const char* result = get_va_provider().get(fmt, ap);
 
 		va_end(ap);
 		return result;
 	}
 
+	const char* find_char(const char* begin, const char* end, const char chr)
+	{
+		const auto pattern = _mm_set1_epi8(chr);
+
+		while (end - begin >= 16)
+		{
+			const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+			const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+			if (mask)
+			{
+				return begin + std::countr_zero(mask);
+			}
+
+			begin += 16;
+		}
+
+		while (begin < end && *begin != chr)
+		{
+			++begin;
+		}
+
+		return begin;
+	}
+
 	std::vector<std::string> split(const std::string& s, const char delim)
 	{
-		std::stringstream ss(s);
-		std::string item;
 		std::vector<std::string> elems;
 
-		while (std::getline(ss, item, delim))
+		for (const auto& token : split_view(s, delim))
 		{
-			elems.push_back(item); // elems.push_back(std::move(item)); // if C++11 (based on comment from @mchiasson)
+			elems.emplace_back(token);
 		}
 
 		return elems;
 	}
 
-	std::string to_lower(std::string text)
+	namespace
 	{
-		std::transform(text.begin(), text.end(), text.begin(), [](const char input)
+		constexpr char hex_upper[] = "0123456789ABCDEF";
+		constexpr char hex_lower[] = "0123456789abcdef";
+
+		constexpr auto hex_values = []
+		{
+			std::array<int8_t, 256> values{};
+			values.fill(-1);
+
+			for (auto i = 0; i < 10; ++i)
+			{
+				values['0' + i] = static_cast<int8_t>(i);
+			}
+
+			for (auto i = 0; i < 6; ++i)
+			{
+				values['a' + i] = static_cast<int8_t>(10 + i);
+				values['A' + i] = static_cast<int8_t>(10 + i);
+			}
+
+			return values;
+		}();
+
+		char fold_lower(const char chr)
+		{
+			return (chr >= 'A' && chr <= 'Z') ? static_cast<char>(chr | 0x20) : chr;
+		}
+
+		char fold_upper(const char chr)
+		{
+			return (chr >= 'a' && chr <= 'z') ? static_cast<char>(chr & ~0x20) : chr;
+		}
+
+		// Flips the case bit of every byte in [first, last], signed compares keep bytes >= 0x80 out of range
+		__m128i fold_case(const __m128i block, const char first, const char last)
+		{
+			const auto in_range = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(static_cast<char>(first - 1))),
+			                                    _mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(last + 1))));
+			return _mm_xor_si128(block, _mm_and_si128(in_range, _mm_set1_epi8(0x20)));
+		}
+
+		void fold_case(char* text, const size_t length, const char first, const char last)
+		{
+			size_t i = 0;
+			for (; i + 16 <= length; i += 16)
+			{
+				auto* block = reinterpret_cast<__m128i*>(text + i);
+				_mm_storeu_si128(block, fold_case(_mm_loadu_si128(block), first, last));
+			}
+
+			for (; i < length; ++i)
+			{
+				if (text[i] >= first && text[i] <= last)
+				{
+					text[i] ^= 0x20;
+				}
+			}
+		}
+
+		bool equals_ignore_case(const char* a, const char* b, const size_t length)
 		{
-			return static_cast<char>(tolower(input));
-		});
+			size_t i = 0;
+			for (; i + 16 <= length; i += 16)
+			{
+				const auto block_a = fold_case(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)), 'A', 'Z');
+				const auto block_b = fold_case(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)), 'A', 'Z');
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b)) != 0xFFFF)
+				{
+					return false;
+				}
+			}
 
+			for (; i < length; ++i)
+			{
+				if (fold_lower(a[i]) != fold_lower(b[i]))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	std::string to_lower(std::string text)
+	{
+		to_lower(text.data(), text.size());
 		return text;
 	}
 
 	std::string to_upper(std::string text)
 	{
-		std::transform(text.begin(), text.end(), text.begin(), [](const char input)
+		to_upper(text.data(), text.size());
+		return text;
+	}
+
+	void to_lower(char* text, const size_t length)
+	{
+		fold_case(text, length, 'A', 'Z');
+	}
+
+	void to_upper(char* text, const size_t length)
+	{
+		fold_case(text, length, 'a', 'z');
+	}
+
+	bool equals_ignore_case(const std::string_view a, const std::string_view b)
+	{
+		return a.size() == b.size() && equals_ignore_case(a.data(), b.data(), a.size());
+	}
+
+	size_t find_ignore_case(const std::string_view text, const std::string_view pattern)
+	{
+		if (pattern.empty())
+		{
+			return 0;
+		}
+
+		if (pattern.size() > text.size())
 		{
-			return static_cast<char>(toupper(input));
-		});
+			return std::string_view::npos;
+		}
 
-		return text;
+		const auto lower = fold_lower(pattern[0]);
+		const auto upper = fold_upper(pattern[0]);
+		const auto lower_pattern = _mm_set1_epi8(lower);
+		const auto upper_pattern = _mm_set1_epi8(upper);
+
+		const auto last = text.size() - pattern.size();
+		size_t i = 0;
+
+		// Look for candidates by their first character, 16 positions at a time
+		for (; i + 16 <= last + 1; i += 16)
+		{
+			const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+			auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lower_pattern),
+			                                                                _mm_cmpeq_epi8(block, upper_pattern))));
+			while (mask)
+			{
+				const auto position = i + std::countr_zero(mask);
+				if (equals_ignore_case(text.data() + position + 1, pattern.data() + 1, pattern.size() - 1))
+				{
+					return position;
+				}
+
+				mask &= mask - 1;
+			}
+		}
+
+		for (; i <= last; ++i)
+		{
+			if ((text[i] == lower || text[i] == upper)
+				&& equals_ignore_case(text.data() + i + 1, pattern.data() + 1, pattern.size() - 1))
+			{
+				return i;
+			}
+		}
+
+		return std::string_view::npos;
+	}
+
+	void hex_encode(const void* data, const size_t length, char* output, const bool uppercase)
+	{
+		const auto* table = uppercase ? hex_upper : hex_lower;
+		const auto* bytes = static_cast<const uint8_t*>(data);
+
+		for (size_t i = 0; i < length; ++i)
+		{
+			output[i * 2] = table[bytes[i] >> 4];
+			output[i * 2 + 1] = table[bytes[i] & 0xF];
+		}
+	}
+
+	bool hex_decode(const std::string_view hex, void* output)
+	{
+		if (hex.size() % 2)
+		{
+			return false;
+		}
+
+		auto* bytes = static_cast<uint8_t*>(output);
+
+		for (size_t i = 0; i < hex.size(); i += 2)
+		{
+			const auto high = hex_values[static_cast<uint8_t>(hex[i])];
+			const auto low = hex_values[static_cast<uint8_t>(hex[i + 1])];
+			if (high < 0 || low < 0)
+			{
+				return false;
+			}
+
+			bytes[i / 2] = static_cast<uint8_t>((high << 4) | low);
+		}
+
+		return true;
 	}
 
 	bool starts_with(const std::string& text, const std::string& substring)
@@ -67,16 +275,30 @@ namespace utils::string
 
 	std::string dump_hex(const std::string& data, const std::string& separator)
 	{
-		std::string result;
+		if (data.empty())
+		{
+			return {};
+		}
 
-		for (unsigned int i = 0; i < data.size(); ++i)
+		if (separator.empty())
 		{
-			if (i > 0)
+			std::string result(data.size() * 2, '\0');
+			hex_encode(data.data(), data.size(), result.data());
+			return result;
+		}
+
+		const auto stride = 2 + separator.size();
+		std::string result(data.size() * stride - separator.size(), '\0');
+
+		for (size_t i = 0; i < data.size(); ++i)
+		{
+			auto* output = result.data() + i * stride;
+			hex_encode(&data[i], 1, output);
+
+			if (i + 1 < data.size())
 			{
-				result.append(separator);
+				std::memcpy(output + 2, separator.data(), separator.size());
 			}
-
-			result.append(va("%02X", data[i] & 0xFF));
 		}
 
 		return result;
@@ -131,34 +353,337 @@ namespace utils::string
 		*out = '\0';
 	}
 
-#pragma warning(push)
-#pragma warning(disable: 4100)
-	std::string convert(const std::wstring& wstr)
+	namespace
 	{
-		std::string result;
-		result.reserve(wstr.size());
+		static_assert(sizeof(wchar_t) == sizeof(uint16_t));
+
+		// Returns the length of the sequence or 0 if it is malformed
+		size_t decode_utf8(const uint8_t* data, const size_t available, uint32_t& code_point)
+		{
+			const auto lead = data[0];
+
+			size_t length{};
+			uint32_t min_code_point{};
+
+			if ((lead & 0xE0) == 0xC0)
+			{
+				length = 2;
+				code_point = lead & 0x1F;
+				min_code_point = 0x80;
+			}
+			else if ((lead & 0xF0) == 0xE0)
+			{
+				length = 3;
+				code_point = lead & 0x0F;
+				min_code_point = 0x800;
+			}
+			else if ((lead & 0xF8) == 0xF0)
+			{
+				length = 4;
+				code_point = lead & 0x07;
+				min_code_point = 0x10000;
+			}
+			else
+			{
+				return 0;
+			}
 
-		for (const auto& chr : wstr)
+			if (length > available)
+			{
+				return 0;
+			}
+
+			for (size_t i = 1; i < length; ++i)
+			{
+				if ((data[i] & 0xC0) != 0x80)
+				{
+					return 0;
+				}
+
+				code_point = (code_point << 6) | (data[i] & 0x3F);
+			}
+
+			if (code_point < min_code_point || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+			{
+				return 0;
+			}
+
+			return length;
+		}
+
+		// Returns the number of units or 0 if there is an unpaired surrogate
+		size_t decode_utf16(const wchar_t* data, const size_t available, uint32_t& code_point)
 		{
-			result.push_back(static_cast<char>(chr));
+			const auto unit = static_cast<uint16_t>(data[0]);
+			if (unit < 0xD800 || unit > 0xDFFF)
+			{
+				code_point = unit;
+				return 1;
+			}
+
+			if (unit >= 0xDC00 || available < 2)
+			{
+				return 0;
+			}
+
+			const auto trail = static_cast<uint16_t>(data[1]);
+			if (trail < 0xDC00 || trail > 0xDFFF)
+			{
+				return 0;
+			}
+
+			code_point = 0x10000 + ((unit - 0xD800u) << 10) + (trail - 0xDC00u);
+			return 2;
 		}
 
+		template <bool Write>
+		size_t transcode_utf8_to_utf16(const std::string_view utf8, wchar_t* output)
+		{
+			const auto* data = reinterpret_cast<const uint8_t*>(utf8.data());
+			const auto length = utf8.size();
+
+			size_t i = 0;
+			size_t written = 0;
+
+			while (i < length)
+			{
+				// ASCII fast path, widens 16 bytes at a time
+				while (i + 16 <= length)
+				{
+					const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+					const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(block));
+					if (mask)
+					{
+						const auto ascii = static_cast<size_t>(std::countr_zero(mask));
+						if constexpr (Write)
+						{
+							for (size_t j = 0; j < ascii; ++j)
+							{
+								output[written + j] = static_cast<wchar_t>(data[i + j]);
+							}
+						}
+
+						i += ascii;
+						written += ascii;
+						break;
+					}
+
+					if constexpr (Write)
+					{
+						const auto zero = _mm_setzero_si128();
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_unpacklo_epi8(block, zero));
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written + 8), _mm_unpackhi_epi8(block, zero));
+					}
+
+					i += 16;
+					written += 16;
+				}
+
+				if (i >= length)
+				{
+					break;
+				}
+
+				if (data[i] < 0x80)
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<wchar_t>(data[i]);
+					}
+
+					++i;
+					++written;
+					continue;
+				}
+
+				uint32_t code_point{};
+				const auto size = decode_utf8(data + i, length - i, code_point);
+				if (!size)
+				{
+					return std::string_view::npos;
+				}
+
+				i += size;
+
+				if (code_point >= 0x10000)
+				{
+					if constexpr (Write)
+					{
+						code_point -= 0x10000;
+						output[written] = static_cast<wchar_t>(0xD800 + (code_point >> 10));
+						output[written + 1] = static_cast<wchar_t>(0xDC00 + (code_point & 0x3FF));
+					}
+
+					written += 2;
+				}
+				else
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<wchar_t>(code_point);
+					}
+
+					++written;
+				}
+			}
+
+			return written;
+		}
+
+		template <bool Write>
+		size_t transcode_utf16_to_utf8(const std::wstring_view utf16, char* output)
+		{
+			const auto* data = utf16.data();
+			const auto length = utf16.size();
+
+			size_t i = 0;
+			size_t written = 0;
+
+			while (i < length)
+			{
+				// ASCII fast path, narrows 16 units at a time
+				while (i + 16 <= length)
+				{
+					const auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+					const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 8));
+					const auto non_ascii = _mm_and_si128(_mm_or_si128(low, high), _mm_set1_epi16(static_cast<short>(0xFF80)));
+					if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, _mm_setzero_si128())) != 0xFFFF)
+					{
+						break;
+					}
+
+					if constexpr (Write)
+					{
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(output + written), _mm_packus_epi16(low, high));
+					}
+
+					i += 16;
+					written += 16;
+				}
+
+				if (i >= length)
+				{
+					break;
+				}
+
+				uint32_t code_point{};
+				const auto size = decode_utf16(data + i, length - i, code_point);
+				if (!size)
+				{
+					return std::wstring_view::npos;
+				}
+
+				i += size;
+
+				if (code_point < 0x80)
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<char>(code_point);
+					}
+
+					++written;
+				}
+				else if (code_point < 0x800)
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<char>(0xC0 | (code_point >> 6));
+						output[written + 1] = static_cast<char>(0x80 | (code_point & 0x3F));
+					}
+
+					written += 2;
+				}
+				else if (code_point < 0x10000)
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<char>(0xE0 | (code_point >> 12));
+						output[written + 1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+						output[written + 2] = static_cast<char>(0x80 | (code_point & 0x3F));
+					}
+
+					written += 3;
+				}
+				else
+				{
+					if constexpr (Write)
+					{
+						output[written] = static_cast<char>(0xF0 | (code_point >> 18));
+						output[written + 1] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+						output[written + 2] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+						output[written + 3] = static_cast<char>(0x80 | (code_point & 0x3F));
+					}
+
+					written += 4;
+				}
+			}
+
+			return written;
+		}
+	}
+
+	size_t get_utf16_length(const std::string_view utf8)
+	{
+		return transcode_utf8_to_utf16<false>(utf8, nullptr);
+	}
+
+	size_t get_utf8_length(const std::wstring_view utf16)
+	{
+		return transcode_utf16_to_utf8<false>(utf16, nullptr);
+	}
+
+	size_t utf8_to_utf16(const std::string_view utf8, wchar_t* output)
+	{
+		return transcode_utf8_to_utf16<true>(utf8, output);
+	}
+
+	size_t utf16_to_utf8(const std::wstring_view utf16, char* output)
+	{
+		return transcode_utf16_to_utf8<true>(utf16, output);
+	}
+
+	std::string convert(const std::wstring& wstr)
+	{
+		const auto length = get_utf8_length(wstr);
+		if (length == std::wstring_view::npos)
+		{
+			std::string result;
+			result.reserve(wstr.size());
+
+			for (const auto& chr : wstr)
+			{
+				result.push_back(static_cast<char>(chr));
+			}
+
+			return result;
+		}
+
+		std::string result(length, '\0');
+		utf16_to_utf8(wstr, result.data());
 		return result;
 	}
 
 	std::wstring convert(const std::string& str)
 	{
-		std::wstring result;
-		result.reserve(str.size());
-
-		for (const auto& chr : str)
+		const auto length = get_utf16_length(str);
+		if (length == std::string_view::npos)
 		{
-			result.push_back(static_cast<wchar_t>(chr));
+			std::wstring result;
+			result.reserve(str.size());
+
+			for (const auto& chr : str)
+			{
+				result.push_back(static_cast<wchar_t>(static_cast<uint8_t>(chr)));
+			}
+
+			return result;
 		}
 
+		std::wstring result(length, L'\0');
+		utf8_to_utf16(str, result.data());
 		return result;
 	}
-#pragma warning(pop)
 
 	std::string replace(std::string str, const std::string& from, const std::string& to)
 	{
@@ -1,6 +1,13 @@
 #pragma once
 #include "memory.hpp"
+#include <cstdarg>
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <string_view>
 
 #ifndef ARRAYSIZE
 template <class Type, size_t n>
@@ -9,81 +16,208 @@ size_t ARRAYSIZE(Type (&)[n]) { return n; }
 
 namespace utils::string
 {
-	template <size_t Buffers, size_t MinBufferSize>
+	// Ring of inline buffers, results stay valid until the ring wraps around.
+	// Only strings that exceed BufferSize fall back to a per-slot heap buffer, which is kept for reuse.
+	template <size_t Buffers, size_t BufferSize>
 	class va_provider final
 	{
 	public:
-		static_assert(Buffers != 0 && MinBufferSize != 0, "Buffers and MinBufferSize mustn't be 0");
+		static_assert(Buffers != 0 && BufferSize != 0, "Buffers and BufferSize mustn't be 0");
 
-		va_provider() : current_buffer_(0)
+		char* get(const char* format, va_list ap)
 		{
-		}
+			auto& entry = this->next_entry();
 
-		char* get(const char* format, const va_list ap)
-		{
-			++this->current_buffer_ %= ARRAYSIZE(this->string_pool_);
-			auto entry = &this->string_pool_[this->current_buffer_];
+			va_list size_ap;
+			va_copy(size_ap, ap);
+			const auto length = vsnprintf(entry.buffer, BufferSize, format, size_ap);
+			va_end(size_ap);
 
-			if (!entry->size || !entry->buffer)
+			if (length < 0)
 			{
-				throw std::runtime_error("String pool not initialized");
+				return nullptr;
 			}
 
-			while (true)
+			if (static_cast<size_t>(length) < BufferSize)
 			{
-				const int res = vsnprintf_s(entry->buffer, entry->size, _TRUNCATE, format, ap);
-				if (res > 0) break; // Success
-				if (res == 0) return nullptr; // Error
+				return entry.buffer;
+			}
+
+			auto* buffer = entry.get_overflow(static_cast<size_t>(length) + 1);
+			vsnprintf(buffer, static_cast<size_t>(length) + 1, format, ap);
+			return buffer;
+		}
+
+		template <typename... Args>
+		char* format(const std::format_string<Args...> fmt, Args&&... args)
+		{
+			auto& entry = this->next_entry();
 
-				entry->double_size();
+			const auto result = std::format_to_n(entry.buffer, BufferSize - 1, fmt, std::forward<Args>(args)...);
+			if (static_cast<size_t>(result.size) < BufferSize)
+			{
+				*result.out = '\0';
+				return entry.buffer;
 			}
 
-			return entry->buffer;
+			auto* buffer = entry.get_overflow(static_cast<size_t>(result.size) + 1);
+			*std::format_to(buffer, fmt, std::forward<Args>(args)...) = '\0';
+			return buffer;
 		}
 
 	private:
 		class entry final
 		{
 		public:
-			entry(const size_t _size = MinBufferSize) : size(_size), buffer(nullptr)
+			char* get_overflow(const size_t size)
+			{
+				if (size > this->overflow_size)
+				{
+					this->overflow = std::make_unique<char[]>(size);
+					this->overflow_size = size;
+				}
+
+				return this->overflow.get();
+			}
+
+			char buffer[BufferSize]{};
+			std::unique_ptr<char[]> overflow{};
+			size_t overflow_size{};
+		};
+
+		entry& next_entry()
+		{
+			++this->current_buffer_ %= Buffers;
+			return this->string_pool_[this->current_buffer_];
+		}
+
+		size_t current_buffer_{};
+		entry string_pool_[Buffers]{};
+	};
+
+	va_provider<8, 256>& get_va_provider();
+
+	const char* va(const char* fmt, ...);
+
+	// Typed variant of va, the format string is checked at compile time
+	template <typename... Args>
+	const char* va_format(const std::format_string<Args...> fmt, Args&&... args)
+	{
+		return get_va_provider().format(fmt, std::forward<Args>(args)...);
+	}
+
+	// Returns the first occurrence of chr in [begin, end) or end
+	const char* find_char(const char* begin, const char* end, char chr);
+
+	// Lazily yields the tokens of a string as views into it, nothing is copied.
+	// Tokens are produced like split does, a trailing empty token is dropped.
+	class split_view final
+	{
+	public:
+		class iterator final
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = std::string_view;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const std::string_view*;
+			using reference = const std::string_view&;
+
+			iterator() = default;
+
+			iterator(const std::string_view text, const char delim, const size_t position)
+				: text_(text), delim_(delim), position_(position)
+			{
+				this->load();
+			}
+
+			reference operator*() const
+			{
+				return this->token_;
+			}
+
+			pointer operator->() const
 			{
-				if (this->size < MinBufferSize) this->size = MinBufferSize;
-				this->allocate();
+				return &this->token_;
 			}
 
-			~entry()
+			iterator& operator++()
 			{
-				if (this->buffer) memory::get_allocator()->free(this->buffer);
-				this->size = 0;
-				this->buffer = nullptr;
+				this->position_ = std::min(this->position_ + this->token_.size() + 1, this->text_.size());
+				this->load();
+				return *this;
 			}
 
-			void allocate()
+			iterator operator++(int)
 			{
-				if (this->buffer) memory::get_allocator()->free(this->buffer);
-				this->buffer = memory::get_allocator()->allocate_array<char>(this->size + 1);
+				auto copy = *this;
+				++*this;
+				return copy;
 			}
 
-			void double_size()
+			bool operator==(const iterator& obj) const
 			{
-				this->size *= 2;
-				this->allocate();
+				return this->position_ == obj.position_;
 			}
 
-			size_t size{};
-			char* buffer{nullptr};
+		private:
+			std::string_view text_{};
+			char delim_{};
+			size_t position_{};
+			std::string_view token_{};
+
+			void load()
+			{
+				if (this->position_ >= this->text_.size())
+				{
+					this->position_ = this->text_.size();
+					this->token_ = {};
+					return;
+				}
+
+				const auto* begin = this->text_.data() + this->position_;
+				const auto* end = this->text_.data() + this->text_.size();
+				this->token_ = {begin, static_cast<size_t>(find_char(begin, end, this->delim_) - begin)};
+			}
 		};
 
-		size_t current_buffer_{};
-		entry string_pool_[Buffers]{};
-	};
+		split_view(const std::string_view text, const char delim)
+			: text_(text), delim_(delim)
+		{
+		}
 
-	const char* va(const char* fmt, ...);
+		iterator begin() const
+		{
+			return {this->text_, this->delim_, 0};
+		}
+
+		iterator end() const
+		{
+			return {this->text_, this->delim_, this->text_.size()};
+		}
+
+	private:
+		std::string_view text_{};
+		char delim_{};
+	};
 
 	std::vector<std::string> split(const std::string& s, char delim);
 
 	std::string to_lower(std::string text);
 	std::string to_upper(std::string text);
+
+	// ASCII case folding in place, bytes outside A-Z/a-z are left untouched
+	void to_lower(char* text, size_t length);
+	void to_upper(char* text, size_t length);
+
+	bool equals_ignore_case(std::string_view a, std::string_view b);
+	size_t find_ignore_case(std::string_view text, std::string_view pattern);
+
+	// Writes length * 2 characters to output, no terminator
+	void hex_encode(const void* data, size_t length, char* output, bool uppercase = true);
+
+	// Writes hex.size() / 2 bytes to output, fails on odd length or invalid characters
+	bool hex_decode(std::string_view hex, void* output);
 	bool starts_with(const std::string& text, const std::string& substring);
 	bool ends_with(const std::string& text, const std::string& substring);
 
@@ -93,6 +227,16 @@ namespace utils::string
 
 	void strip(const char* in, char* out, int max);
 
+	// Pre-pass for the transcoders, returns the required output length or npos if the input is malformed
+	size_t get_utf16_length(std::string_view utf8);
+	size_t get_utf8_length(std::wstring_view utf16);
+
+	// Output must hold the length returned by the pre-pass, nothing is terminated.
+	// Returns the number of units written or npos if the input is malformed.
+	size_t utf8_to_utf16(std::string_view utf8, wchar_t* output);
+	size_t utf16_to_utf8(std::wstring_view utf16, char* output);
+
+	// Malformed input falls back to widening/narrowing every unit as is
 	std::string convert(const std::wstring& wstr);
 	std::wstring convert(const std::string& str);
 
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utils
+{
+	template <typename Signature, size_t BufferSize = 6 * sizeof(void*)>
+	class unique_function;
+
+	// Move-only replacement for std::function.
+	// Callables that fit into the inline buffer are stored without allocating.
+	template <typename R, typename... Args, size_t BufferSize>
+	class unique_function<R(Args...), BufferSize>
+	{
+	public:
+		static_assert(BufferSize >= sizeof(void*), "BufferSize must be able to hold a pointer");
+
+		template <typename F>
+		static constexpr bool is_stored_inline = sizeof(F) <= BufferSize
+			&& alignof(F) <= alignof(std::max_align_t)
+			&& std::is_nothrow_move_constructible_v<F>;
+
+		unique_function() = default;
+
+		unique_function(std::nullptr_t)
+		{
+		}
+
+		template <typename F, typename Callable = std::decay_t<F>,
+		          typename = std::enable_if_t<!std::is_same_v<Callable, unique_function>
+			          && std::is_invocable_r_v<R, Callable&, Args...>>>
+		unique_function(F&& callable)
+		{
+			if constexpr (is_stored_inline<Callable>)
+			{
+				new(this->buffer_) Callable(std::forward<F>(callable));
+			}
+			else
+			{
+				*reinterpret_cast<Callable**>(this->buffer_) = new Callable(std::forward<F>(callable));
+			}
+
+			this->operations_ = &operations_for<Callable>;
+		}
+
+		~unique_function()
+		{
+			this->reset();
+		}
+
+		unique_function(unique_function&& other) noexcept
+		{
+			this->move_from(other);
+		}
+
+		unique_function& operator=(unique_function&& other) noexcept
+		{
+			if (this != &other)
+			{
+				this->reset();
+				this->move_from(other);
+			}
+
+			return *this;
+		}
+
+		unique_function(const unique_function&) = delete;
+		unique_function& operator=(const unique_function&) = delete;
+
+		R operator()(Args... args)
+		{
+			return this->operations_->invoke(this->buffer_, std::forward<Args>(args)...);
+		}
+
+		explicit operator bool() const
+		{
+			return this->operations_ != nullptr;
+		}
+
+		void reset()
+		{
+			if (this->operations_)
+			{
+				this->operations_->destroy(this->buffer_);
+				this->operations_ = nullptr;
+			}
+		}
+
+	private:
+		struct operations
+		{
+			R (*invoke)(void* buffer, Args&&... args);
+			void (*move)(void* target, void* source) noexcept;
+			void (*destroy)(void* buffer) noexcept;
+		};
+
+		template <typename Callable>
+		static Callable* get_callable(void* buffer)
+		{
+			if constexpr (is_stored_inline<Callable>)
+			{
+				return std::launder(reinterpret_cast<Callable*>(buffer));
+			}
+			else
+			{
+				return *reinterpret_cast<Callable**>(buffer);
+			}
+		}
+
+		template <typename Callable>
+		static constexpr operations operations_for{
+			[](void* buffer, Args&&... args) -> R
+			{
+				return static_cast<R>((*get_callable<Callable>(buffer))(std::forward<Args>(args)...));
+			},
+			[](void* target, void* source) noexcept
+			{
+				if constexpr (is_stored_inline<Callable>)
+				{
+					auto* callable = get_callable<Callable>(source);
+					new(target) Callable(std::move(*callable));
+					callable->~Callable();
+				}
+				else
+				{
+					*reinterpret_cast<Callable**>(target) = get_callable<Callable>(source);
+				}
+			},
+			[](void* buffer) noexcept
+			{
+				if constexpr (is_stored_inline<Callable>)
+				{
+					get_callable<Callable>(buffer)->~Callable();
+				}
+				else
+				{
+					delete get_callable<Callable>(buffer);
+				}
+			},
+		};
+
+		alignas(std::max_align_t) unsigned char buffer_[BufferSize]{};
+		const operations* operations_{};
+
+		void move_from(unique_function& other) noexcept
+		{
+			if (other.operations_)
+			{
+				other.operations_->move(this->buffer_, other.buffer_);
+				this->operations_ = other.operations_;
+				other.operations_ = nullptr;
+			}
+		}
+	};
+}
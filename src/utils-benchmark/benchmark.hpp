@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace benchmark
+{
+	// Repeats the callback until the minimum time passed, returns the average time of one run
+	template <typename F>
+	std::chrono::duration<double> measure(F&& callback, const std::chrono::milliseconds min_time = 200ms)
+	{
+		// One untimed run warms up caches and lazily allocated buffers
+		callback();
+
+		size_t runs = 0;
+		const auto start = std::chrono::steady_clock::now();
+		auto end = start;
+
+		do
+		{
+			callback();
+			++runs;
+			end = std::chrono::steady_clock::now();
+		}
+		while (end - start < min_time);
+
+		return std::chrono::duration<double>(end - start) / static_cast<double>(runs);
+	}
+
+	inline double get_throughput(const size_t bytes, const std::chrono::duration<double> time)
+	{
+		return static_cast<double>(bytes) / time.count() / (1024.0 * 1024.0);
+	}
+
+	// Keeps results alive, so the measured work isn't optimized away
+	void consume(uint64_t value);
+
+	// Words of random length from a small vocabulary, compresses roughly like config and script files
+	std::string create_text(std::mt19937& rng, size_t length);
+
+	void run_split_benchmark();
+	void run_text_benchmark();
+	void run_zip_benchmark();
+	void run_codec_benchmark();
+	void run_dictionary_benchmark();
+}
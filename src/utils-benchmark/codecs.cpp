@@ -0,0 +1,104 @@
+#include "benchmark.hpp"
+
+#include <utils/compression.hpp>
+
+namespace benchmark
+{
+	namespace
+	{
+		using utils::compression::codec_type;
+
+		struct payload
+		{
+			const char* name{};
+			std::vector<std::string> messages{};
+		};
+
+		std::vector<payload> create_payloads()
+		{
+			std::mt19937 rng{49};
+
+			payload large{"text 8 MiB"};
+			large.messages.emplace_back(create_text(rng, 8 * 1024 * 1024));
+
+			// Sizes of typical network messages
+			payload small{"text 64-512 B"};
+			std::uniform_int_distribution<size_t> size_distribution{64, 512};
+			for (size_t i = 0; i < 4'096; ++i)
+			{
+				small.messages.emplace_back(create_text(rng, size_distribution(rng)));
+			}
+
+			// Doesn't compress, the frames store it as is
+			payload random{"random 1 MiB"};
+			std::string data(1024 * 1024, '\0');
+			for (auto& character : data)
+			{
+				character = static_cast<char>(rng());
+			}
+
+			random.messages.emplace_back(std::move(data));
+
+			return {std::move(large), std::move(small), std::move(random)};
+		}
+
+		void run_codec(const payload& payload, const char* codec_name, const codec_type type, const int level)
+		{
+			size_t raw_size = 0;
+			for (const auto& message : payload.messages)
+			{
+				raw_size += message.size();
+			}
+
+			std::vector<std::string> frames(payload.messages.size());
+			auto success = true;
+
+			const auto compress_time = measure([&]
+			{
+				for (size_t i = 0; i < payload.messages.size(); ++i)
+				{
+					frames[i] = utils::compression::compress(payload.messages[i], type, level);
+				}
+			});
+
+			size_t compressed_size = 0;
+			for (const auto& frame : frames)
+			{
+				compressed_size += frame.size();
+			}
+
+			const auto decompress_time = measure([&]
+			{
+				for (size_t i = 0; i < frames.size(); ++i)
+				{
+					const auto data = utils::compression::decompress(frames[i]);
+					success &= data && data->size() == payload.messages[i].size();
+				}
+			});
+
+			printf("%-16s %-6s %6d %8.3f %12.1f %12.1f%s\n", payload.name, codec_name, level,
+			       static_cast<double>(raw_size) / static_cast<double>(compressed_size),
+			       get_throughput(raw_size, compress_time), get_throughput(raw_size, decompress_time),
+			       success ? "" : "  failed");
+		}
+	}
+
+	void run_codec_benchmark()
+	{
+		printf("Framed one-shot compression, MB/s refer to the uncompressed size\n\n");
+		printf("%-16s %-6s %6s %8s %12s %12s\n", "payload", "codec", "level", "ratio", "comp MB/s", "decomp MB/s");
+
+		for (const auto& payload : create_payloads())
+		{
+			for (const auto level : {utils::compression::zlib::best_speed, 6, utils::compression::zlib::best_compression})
+			{
+				run_codec(payload, "zlib", codec_type::zlib, level);
+			}
+
+			// LZ4 has no levels
+			run_codec(payload, "lz4", codec_type::lz4, 0);
+
+			printf("\n");
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#include "benchmark.hpp"
+
+namespace benchmark
+{
+	// Words of random length from a small vocabulary, compresses roughly like config and script files
+	std::string create_text(std::mt19937& rng, const size_t length)
+	{
+		std::vector<std::string> words{};
+		std::uniform_int_distribution<size_t> length_distribution{2, 10};
+		std::uniform_int_distribution<int> character_distribution{'a', 'z'};
+
+		for (size_t i = 0; i < 512; ++i)
+		{
+			std::string word(length_distribution(rng), '\0');
+			for (auto& character : word)
+			{
+				character = static_cast<char>(character_distribution(rng));
+			}
+
+			words.emplace_back(std::move(word));
+		}
+
+		std::uniform_int_distribution<size_t> word_distribution{0, words.size() - 1};
+
+		std::string text{};
+		text.reserve(length + 16);
+
+		while (text.size() < length)
+		{
+			text += words[word_distribution(rng)];
+			text += (text.size() % 80 < 8) ? '\n' : ' ';
+		}
+
+		text.resize(length);
+		return text;
+	}
+}
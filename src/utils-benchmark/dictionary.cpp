@@ -0,0 +1,142 @@
+#include "benchmark.hpp"
+
+#include <utils/compression.hpp>
+
+namespace benchmark
+{
+	namespace
+	{
+		// Server info strings with a fixed key set, some keys missing and values that vary per server
+		std::string create_server_info(std::mt19937& rng)
+		{
+			static const char* keys[] = {
+				"hostname", "mapname", "gametype", "sv_maxclients", "protocol", "fs_game", "sv_running", "clients",
+				"bots", "isPrivate", "playmode",
+			};
+
+			std::string info{};
+
+			for (const auto* key : keys)
+			{
+				if (rng() % 4 == 0)
+				{
+					continue;
+				}
+
+				info += "\\";
+				info += key;
+				info += "\\";
+
+				if (rng() % 2)
+				{
+					info += std::to_string(rng() % 100);
+				}
+				else
+				{
+					info += "mp_";
+					info += "abcdefgh"[rng() % 8];
+					info += "_map";
+				}
+			}
+
+			return info;
+		}
+	}
+
+	void run_dictionary_benchmark()
+	{
+		std::mt19937 rng{50};
+
+		// The dictionary is trained on other messages than the ones it is measured with
+		std::vector<std::string> samples{};
+		for (size_t i = 0; i < 500; ++i)
+		{
+			samples.emplace_back(create_server_info(rng));
+		}
+
+		std::vector<std::string> messages{};
+		size_t raw_size = 0;
+
+		for (size_t i = 0; i < 2'000; ++i)
+		{
+			messages.emplace_back(create_server_info(rng));
+			raw_size += messages.back().size();
+		}
+
+		printf("%zu server info strings, %zu bytes raw\n\n", messages.size(), raw_size);
+		printf("%-20s %10s %10s %8s %12s %12s\n", "method", "dict size", "bytes", "ratio", "comp MB/s",
+		       "decomp MB/s");
+
+		const auto print_result = [&](const char* name, const size_t dictionary_size, const size_t size,
+		                              const std::chrono::duration<double> compress_time,
+		                              const std::chrono::duration<double> decompress_time, const bool success)
+		{
+			printf("%-20s %10zu %10zu %8.3f %12.1f %12.1f%s\n", name, dictionary_size, size,
+			       static_cast<double>(raw_size) / static_cast<double>(size), get_throughput(raw_size, compress_time),
+			       get_throughput(raw_size, decompress_time), success ? "" : "  failed");
+		};
+
+		std::vector<std::string> frames(messages.size());
+
+		const auto get_frames_size = [&]
+		{
+			size_t size = 0;
+			for (const auto& frame : frames)
+			{
+				size += frame.size();
+			}
+
+			return size;
+		};
+
+		{
+			auto success = true;
+
+			const auto compress_time = measure([&]
+			{
+				for (size_t i = 0; i < messages.size(); ++i)
+				{
+					frames[i] = utils::compression::compress(messages[i], utils::compression::codec_type::zlib,
+					                                         utils::compression::zlib::best_compression);
+				}
+			});
+
+			const auto decompress_time = measure([&]
+			{
+				for (size_t i = 0; i < frames.size(); ++i)
+				{
+					success &= utils::compression::decompress(frames[i]) == messages[i];
+				}
+			});
+
+			print_result("zlib per message", 0, get_frames_size(), compress_time, decompress_time, success);
+		}
+
+		for (const size_t dictionary_size : {1'024u, 4'096u, 16'384u, 32'768u})
+		{
+			auto dictionary = utils::compression::train_dictionary(1, samples, dictionary_size);
+			const auto trained_size = dictionary.data.size();
+
+			utils::compression::dictionary_compressor compressor{std::move(dictionary)};
+			auto success = true;
+
+			const auto compress_time = measure([&]
+			{
+				for (size_t i = 0; i < messages.size(); ++i)
+				{
+					frames[i] = compressor.compress(messages[i]);
+				}
+			});
+
+			const auto decompress_time = measure([&]
+			{
+				for (size_t i = 0; i < frames.size(); ++i)
+				{
+					success &= compressor.decompress(frames[i]) == messages[i];
+				}
+			});
+
+			print_result("dictionary", trained_size, get_frames_size(), compress_time, decompress_time, success);
+		}
+	}
+}
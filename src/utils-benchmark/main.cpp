@@ -0,0 +1,70 @@
+#include "benchmark.hpp"
+
+#include <cstring>
+
+namespace benchmark
+{
+	namespace
+	{
+		volatile uint64_t sink{};
+
+		struct entry
+		{
+			const char* name;
+			void (*run)();
+		};
+
+		const entry benchmarks[] = {
+			{"split", run_split_benchmark},
+			{"text", run_text_benchmark},
+			{"zip", run_zip_benchmark},
+			{"codecs", run_codec_benchmark},
+			{"dictionary", run_dictionary_benchmark},
+		};
+	}
+
+	void consume(const uint64_t value)
+	{
+		sink = sink + value;
+	}
+}
+
+// utils-benchmark [name...], runs everything if no name is given
+int main(const int argc, char** argv)
+{
+	auto ran_any = false;
+
+	for (const auto& entry : benchmark::benchmarks)
+	{
+		auto selected = argc < 2;
+		for (auto i = 1; i < argc && !selected; ++i)
+		{
+			selected = strcmp(argv[i], entry.name) == 0;
+		}
+
+		if (!selected)
+		{
+			continue;
+		}
+
+		printf("== %s ==\n\n", entry.name);
+		entry.run();
+		printf("\n");
+
+		ran_any = true;
+	}
+
+	if (!ran_any)
+	{
+		printf("Unknown benchmark, available:");
+		for (const auto& entry : benchmark::benchmarks)
+		{
+			printf(" %s", entry.name);
+		}
+
+		printf("\n");
+		return 1;
+	}
+
+	return 0;
+}
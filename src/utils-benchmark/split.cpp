@@ -0,0 +1,89 @@
+#include "benchmark.hpp"
+
+#include <utils/info_string.hpp>
+#include <utils/string.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+namespace benchmark
+{
+	namespace
+	{
+		// The stringstream based split that split_view replaced
+		std::vector<std::string> split_stream(const std::string& s, const char delim)
+		{
+			std::stringstream ss(s);
+			std::string item;
+			std::vector<std::string> elems;
+
+			while (std::getline(ss, item, delim))
+			{
+				elems.push_back(item);
+			}
+
+			return elems;
+		}
+
+		// Looks like the server info strings, short keys and values of mixed length
+		std::string create_info_string(const size_t pair_count)
+		{
+			std::string result{};
+
+			for (size_t i = 0; i < pair_count; ++i)
+			{
+				result += "\\sv_key" + std::to_string(i);
+				result += "\\" + std::string(4 + (i * 7) % 40, static_cast<char>('a' + i % 26));
+			}
+
+			return result;
+		}
+
+		void print_result(const char* name, const std::string& text, const std::chrono::duration<double> time)
+		{
+			const auto tokens = static_cast<double>(std::ranges::count(text, '\\') + 1);
+
+			printf("%-16s %8zu %12.1f %12.1f\n", name, text.size(), get_throughput(text.size(), time),
+			       std::chrono::duration<double, std::nano>(time).count() / tokens);
+		}
+	}
+
+	void run_split_benchmark()
+	{
+		printf("%-16s %8s %12s %12s\n", "method", "bytes", "MB/s", "ns/token");
+
+		for (const auto pair_count : {8u, 64u, 512u, 4096u})
+		{
+			const auto text = create_info_string(pair_count);
+
+			print_result("stringstream", text, measure([&]
+			{
+				consume(split_stream(text, '\\').size());
+			}));
+
+			print_result("split", text, measure([&]
+			{
+				consume(utils::string::split(text, '\\').size());
+			}));
+
+			print_result("split_view", text, measure([&]
+			{
+				uint64_t length = 0;
+				for (const auto token : utils::string::split_view(text, '\\'))
+				{
+					length += token.size();
+				}
+
+				consume(length);
+			}));
+
+			print_result("info_string", text, measure([&]
+			{
+				const utils::info_string info{text};
+				consume(info.size());
+			}));
+
+			printf("\n");
+		}
+	}
+}
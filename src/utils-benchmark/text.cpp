@@ -0,0 +1,134 @@
+#include "benchmark.hpp"
+
+#include <utils/string.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+
+namespace benchmark
+{
+	namespace
+	{
+		// The byte wise versions the text kernels replaced
+		std::string to_lower_transform(std::string text)
+		{
+			std::transform(text.begin(), text.end(), text.begin(), [](const char input)
+			{
+				return static_cast<char>(tolower(input));
+			});
+
+			return text;
+		}
+
+		std::string dump_hex_va(const std::string& data)
+		{
+			std::string result;
+
+			for (size_t i = 0; i < data.size(); ++i)
+			{
+				if (i > 0)
+				{
+					result.append(" ");
+				}
+
+				result.append(utils::string::va("%02X", data[i] & 0xFF));
+			}
+
+			return result;
+		}
+
+		std::string create_mixed_case_text(const size_t length)
+		{
+			constexpr char characters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_- ";
+
+			std::mt19937 rng{static_cast<uint32_t>(length)};
+			std::uniform_int_distribution<size_t> distribution{0, sizeof(characters) - 2};
+
+			std::string text(length, '\0');
+			for (auto& character : text)
+			{
+				character = characters[distribution(rng)];
+			}
+
+			return text;
+		}
+
+		void print_result(const char* name, const size_t length, const std::chrono::duration<double> time)
+		{
+			printf("%-24s %8zu %12.1f\n", name, length, get_throughput(length, time));
+		}
+	}
+
+	void run_text_benchmark()
+	{
+		printf("%-24s %8s %12s\n", "method", "bytes", "MB/s");
+
+		for (const auto length : {16u, 256u, 4096u, 65536u})
+		{
+			const auto text = create_mixed_case_text(length);
+			const auto upper_text = utils::string::to_upper(text);
+
+			// Only the last characters match, so the search has to scan everything
+			const auto pattern = upper_text.substr(length - std::min<size_t>(length, 8));
+
+			auto buffer = text;
+
+			print_result("to_lower transform", length, measure([&]
+			{
+				consume(to_lower_transform(text).size());
+			}));
+
+			print_result("to_lower in place", length, measure([&]
+			{
+				buffer = text;
+				utils::string::to_lower(buffer.data(), buffer.size());
+				consume(static_cast<uint8_t>(buffer[0]));
+			}));
+
+			print_result("compare lowered copies", length, measure([&]
+			{
+				consume(to_lower_transform(text) == to_lower_transform(upper_text));
+			}));
+
+			print_result("equals_ignore_case", length, measure([&]
+			{
+				consume(utils::string::equals_ignore_case(text, upper_text));
+			}));
+
+			print_result("find lowered copies", length, measure([&]
+			{
+				consume(to_lower_transform(text).find(to_lower_transform(pattern)));
+			}));
+
+			print_result("find_ignore_case", length, measure([&]
+			{
+				consume(utils::string::find_ignore_case(text, pattern));
+			}));
+
+			print_result("dump_hex per byte va", length, measure([&]
+			{
+				consume(dump_hex_va(text).size());
+			}));
+
+			print_result("dump_hex", length, measure([&]
+			{
+				consume(utils::string::dump_hex(text).size());
+			}));
+
+			std::string hex(length * 2, '\0');
+			print_result("hex_encode", length, measure([&]
+			{
+				utils::string::hex_encode(text.data(), text.size(), hex.data());
+				consume(static_cast<uint8_t>(hex[0]));
+			}));
+
+			print_result("hex_decode", length, measure([&]
+			{
+				consume(utils::string::hex_decode(hex, buffer.data()));
+			}));
+
+			printf("\n");
+		}
+	}
+}
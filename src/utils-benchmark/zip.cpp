@@ -0,0 +1,107 @@
+#include "benchmark.hpp"
+
+#include <utils/compression.hpp>
+#include <utils/io.hpp>
+
+#include <thread>
+
+namespace benchmark
+{
+	namespace
+	{
+		constexpr auto archive_file = "utils-benchmark.zip";
+
+		constexpr size_t small_file_count = 1'000;
+		constexpr size_t large_file_count = 2;
+		constexpr size_t large_file_size = 8 * 1024 * 1024;
+
+		std::vector<std::pair<std::string, std::string>> create_corpus()
+		{
+			std::mt19937 rng{47};
+			std::uniform_int_distribution<size_t> size_distribution{1'024, 16 * 1'024};
+
+			std::vector<std::pair<std::string, std::string>> corpus{};
+
+			for (size_t i = 0; i < small_file_count; ++i)
+			{
+				corpus.emplace_back("small/" + std::to_string(i) + ".txt", create_text(rng, size_distribution(rng)));
+			}
+
+			for (size_t i = 0; i < large_file_count; ++i)
+			{
+				corpus.emplace_back("large/" + std::to_string(i) + ".txt", create_text(rng, large_file_size));
+			}
+
+			return corpus;
+		}
+
+		size_t get_corpus_size(const std::vector<std::pair<std::string, std::string>>& corpus)
+		{
+			size_t size = 0;
+			for (const auto& file : corpus)
+			{
+				size += file.second.size();
+			}
+
+			return size;
+		}
+
+		bool write_archive(const std::vector<std::pair<std::string, std::string>>& corpus, const int level,
+		                   const size_t thread_count)
+		{
+			utils::compression::zip::archive archive{level};
+			for (const auto& [name, data] : corpus)
+			{
+				archive.add(name, data);
+			}
+
+			return archive.write(archive_file, {}, thread_count);
+		}
+	}
+
+	void run_zip_benchmark()
+	{
+		const auto corpus = create_corpus();
+		const auto corpus_size = get_corpus_size(corpus);
+		const auto hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+		printf("%zu files of 1-16 KiB and %zu of %zu MiB, %u hardware threads\n\n", small_file_count,
+		       large_file_count, large_file_size / (1024 * 1024), hardware_threads);
+		printf("%-8s %8s %8s %12s %12s\n", "level", "threads", "ratio", "write MB/s", "extract MB/s");
+
+		std::vector<size_t> thread_counts{1};
+		if (hardware_threads > 1)
+		{
+			thread_counts.emplace_back(hardware_threads);
+		}
+
+		for (const auto level : {utils::compression::zlib::best_speed, 6, utils::compression::zlib::best_compression})
+		{
+			for (const auto thread_count : thread_counts)
+			{
+				auto success = true;
+
+				// Each run already takes long enough, a single timed run is sufficient
+				const auto write_time = measure([&]
+				{
+					success &= write_archive(corpus, level, thread_count);
+				}, 0ms);
+
+				const auto data = utils::io::read_file(archive_file);
+
+				const auto extract_time = measure([&]
+				{
+					const auto files = utils::compression::zip::extract(data, thread_count);
+					success &= files.size() == corpus.size();
+				}, 0ms);
+
+				printf("%-8d %8zu %8.3f %12.1f %12.1f%s\n", level, thread_count,
+				       static_cast<double>(corpus_size) / static_cast<double>(data.size()),
+				       get_throughput(corpus_size, write_time), get_throughput(corpus_size, extract_time),
+				       success ? "" : "  failed");
+			}
+		}
+
+		utils::io::remove_file(archive_file);
+	}
+}